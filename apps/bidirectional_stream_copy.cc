@@ -2,21 +2,145 @@
 
 #include "byte_stream.hh"
 #include "eventloop.hh"
+#include "exception.hh"
 
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <unistd.h>
 
 using namespace std;
 
-void bidirectional_stream_copy( Socket& socket, string_view peer_name )
+namespace {
+constexpr size_t buffer_size = 1048576;
+
+// One direction of the copy. Bytes are copied into a ByteStream and back out of it, or (in splice mode)
+// stay in the kernel and move through a pipe with splice(2). Either way, the ByteStream holds the
+// direction's closed and error state.
+class Relay
 {
-  constexpr size_t buffer_size = 1048576;
+  // The kernel-side buffer used in splice mode
+  struct SplicePipe
+  {
+    FileDescriptor read_end;
+    FileDescriptor write_end;
+    size_t bytes_buffered {};
+    bool full {}; // a splice into the pipe moved nothing although the source was readable
+  };
 
-  EventLoop eventloop {};
+  ByteStream stream_ { buffer_size };
+  optional<SplicePipe> pipe_ {};
+
+  static SplicePipe make_pipe()
+  {
+    array<int, 2> fds {};
+    CheckSystemCall( "pipe2", pipe2( fds.data(), O_NONBLOCK | O_CLOEXEC ) );
+    SplicePipe pipe { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+    // best effort: ask for as much room as the ByteStream has (limited by /proc/sys/fs/pipe-max-size)
+    fcntl( pipe.write_end.fd_num(), F_SETPIPE_SZ, static_cast<int>( buffer_size ) ); // NOLINT(*-vararg)
+    return pipe;
+  }
+
+  // splice() isn't supported by one of the endpoints: move whatever is in the pipe into the ByteStream
+  // (read_from() never leaves more in the pipe than the ByteStream's capacity) and copy from now on
+  void fall_back_to_copying()
+  {
+    cerr << "DEBUG: splice() not supported, falling back to copying.\n";
+    Writer& writer = stream_.writer();
+    while ( pipe_->bytes_buffered > 0 ) {
+      const size_t bytes_read = pipe_->read_end.read( writer.reserve( pipe_->bytes_buffered ) );
+      if ( bytes_read == 0 ) {
+        throw runtime_error( "bidirectional_stream_copy: could not move the splice pipe's "
+                             + to_string( pipe_->bytes_buffered ) + " bytes into the ByteStream" );
+      }
+      writer.commit( bytes_read );
+      pipe_->bytes_buffered -= bytes_read;
+    }
+    pipe_.reset();
+  }
+
+public:
+  explicit Relay( bool use_splice )
+  {
+    if ( use_splice ) {
+      pipe_ = make_pipe();
+    }
+  }
+
+  ByteStream& stream() { return stream_; }
+
+  bool has_room() const
+  {
+    return pipe_ ? !pipe_->full and pipe_->bytes_buffered < buffer_size : stream_.writer().available_capacity() > 0;
+  }
+  uint64_t bytes_buffered() const { return pipe_ ? pipe_->bytes_buffered : stream_.reader().bytes_buffered(); }
+  bool is_finished() const { return stream_.writer().is_closed() and bytes_buffered() == 0; }
+
+  // Move as much as possible from `source` into the relay
+  void read_from( FileDescriptor& source )
+  {
+    if ( pipe_ ) {
+      try {
+        // a pipe slot can hold a whole socket buffer fragment, so the pipe's own size doesn't bound its bytes
+        const size_t bytes_moved = source.splice( pipe_->write_end, buffer_size - pipe_->bytes_buffered );
+        pipe_->bytes_buffered += bytes_moved;
+        pipe_->full = bytes_moved == 0 and not source.eof() and pipe_->bytes_buffered > 0;
+        return;
+      } catch ( const unix_error& e ) {
+        if ( e.error_code() != EINVAL ) {
+          throw;
+        }
+        fall_back_to_copying();
+      }
+    }
+    Writer& writer = stream_.writer();
+    writer.commit( source.read( writer.reserve( writer.available_capacity() ) ) );
+  }
+
+  // Move as much as possible from the relay into `destination`
+  void write_to( FileDescriptor& destination )
+  {
+    if ( pipe_ ) {
+      try {
+        const size_t bytes_moved = pipe_->read_end.splice( destination, pipe_->bytes_buffered );
+        pipe_->bytes_buffered -= bytes_moved;
+        pipe_->full &= bytes_moved == 0;
+        return;
+      } catch ( const unix_error& e ) {
+        if ( e.error_code() != EINVAL ) {
+          throw;
+        }
+        fall_back_to_copying();
+      }
+    }
+    stream_.reader().pop( destination.write( stream_.reader().peek_all() ) );
+  }
+};
+} // namespace
+
+void bidirectional_stream_copy( Socket& socket, string_view peer_name, bool use_splice )
+{
   FileDescriptor input { STDIN_FILENO };
   FileDescriptor output { STDOUT_FILENO };
-  ByteStream outbound { buffer_size };
-  ByteStream inbound { buffer_size };
+  bidirectional_stream_copy( socket, input, output, peer_name, use_splice );
+}
+
+void bidirectional_stream_copy( Socket& socket,
+                                FileDescriptor& input,
+                                FileDescriptor& output,
+                                string_view peer_name,
+                                bool use_splice )
+{
+  EventLoop eventloop {};
+  Relay outbound_relay { use_splice };
+  Relay inbound_relay { use_splice };
+  ByteStream& outbound = outbound_relay.stream();
+  ByteStream& inbound = inbound_relay.stream();
   bool outbound_shutdown { false };
   bool inbound_shutdown { false };
 
@@ -24,22 +148,19 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
   input.set_blocking( false );
   output.set_blocking( false );
 
-  // rule 1: read from stdin into outbound byte stream
+  // rule 1: read from input into outbound byte stream
   eventloop.add_rule(
-    "read from stdin into outbound byte stream",
+    "read from input into outbound byte stream",
     input,
     Direction::In,
     [&] {
-      string data;
-      data.resize( outbound.writer().available_capacity() );
-      input.read( data );
-      outbound.writer().push( move( data ) );
+      outbound_relay.read_from( input );
       if ( input.eof() ) {
         outbound.writer().close();
       }
     },
     [&] {
-      return !outbound.has_error() and !inbound.has_error() and ( outbound.writer().available_capacity() > 0 )
+      return !outbound.has_error() and !inbound.has_error() and outbound_relay.has_room()
              and !outbound.writer().is_closed();
     },
     [&] { outbound.writer().close(); },
@@ -55,17 +176,17 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::Out,
     [&] {
-      if ( outbound.reader().bytes_buffered() ) {
-        outbound.reader().pop( socket.write( outbound.reader().peek() ) );
+      if ( outbound_relay.bytes_buffered() ) {
+        outbound_relay.write_to( socket );
       }
-      if ( outbound.reader().is_finished() ) {
+      if ( outbound_relay.is_finished() ) {
         socket.shutdown( SHUT_WR );
         outbound_shutdown = true;
         cerr << "DEBUG: Outbound stream to " << peer_name << " finished.\n";
       }
     },
     [&] {
-      return outbound.reader().bytes_buffered() or ( outbound.reader().is_finished() and not outbound_shutdown );
+      return outbound_relay.bytes_buffered() or ( outbound_relay.is_finished() and not outbound_shutdown );
     },
     [&] { outbound.writer().close(); },
     [&] {
@@ -80,16 +201,13 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::In,
     [&] {
-      string data;
-      data.resize( inbound.writer().available_capacity() );
-      socket.read( data );
-      inbound.writer().push( move( data ) );
+      inbound_relay.read_from( socket );
       if ( socket.eof() ) {
         inbound.writer().close();
       }
     },
     [&] {
-      return !inbound.has_error() and !outbound.has_error() and ( inbound.writer().available_capacity() > 0 )
+      return !inbound.has_error() and !outbound.has_error() and inbound_relay.has_room()
              and !inbound.writer().is_closed();
     },
     [&] { inbound.writer().close(); },
@@ -99,16 +217,16 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
       inbound.set_error();
     } );
 
-  // rule 4: read from inbound byte stream into stdout
+  // rule 4: read from inbound byte stream into output
   eventloop.add_rule(
-    "read from inbound byte stream into stdout",
+    "read from inbound byte stream into output",
     output,
     Direction::Out,
     [&] {
-      if ( inbound.reader().bytes_buffered() ) {
-        inbound.reader().pop( output.write( inbound.reader().peek() ) );
+      if ( inbound_relay.bytes_buffered() ) {
+        inbound_relay.write_to( output );
       }
-      if ( inbound.reader().is_finished() ) {
+      if ( inbound_relay.is_finished() ) {
         output.close();
         inbound_shutdown = true;
         cerr << "DEBUG: Inbound stream from " << peer_name << " finished"
@@ -116,7 +234,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
       }
     },
     [&] {
-      return inbound.reader().bytes_buffered() or ( inbound.reader().is_finished() and not inbound_shutdown );
+      return inbound_relay.bytes_buffered() or ( inbound_relay.is_finished() and not inbound_shutdown );
     },
     [&] { inbound.writer().close(); },
     [&] {
@@ -3,4 +3,13 @@
 #include "socket.hh"
 
 //! Copy socket input/output to stdin/stdout until finished
-void bidirectional_stream_copy( Socket& socket, std::string_view peer_name );
+//! With `use_splice`, bytes are moved inside the kernel with splice(2) through a pipe in each direction
+//! instead of being copied through user space (falling back to copying if an endpoint doesn't support it)
+void bidirectional_stream_copy( Socket& socket, std::string_view peer_name, bool use_splice = false );
+
+//! Copy socket input/output to `input`/`output` until finished (closing `output` at the end)
+void bidirectional_stream_copy( Socket& socket,
+                                FileDescriptor& input,
+                                FileDescriptor& output,
+                                std::string_view peer_name,
+                                bool use_splice = false );
@@ -3,6 +3,7 @@
 #include "tcp_minnow_socket.hh"
 #include "tun.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -11,6 +12,7 @@
 #include <span>
 #include <string>
 #include <tuple>
+#include <utility>
 
 using namespace std;
 
@@ -35,11 +37,15 @@ void show_usage( const char* argv0, const char* msg )
 
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
+       << "   -m <mss>        Use a maximum segment size of <mss> bytes       (tun MTU - 40)\n\n"
+
        << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
 
        << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
        << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+       << "   -z              Relay stdin/stdout with splice(2)               (copy)\n\n"
+
        << "   -h              Show this message.\n\n";
 
   if ( msg != nullptr ) {
@@ -56,7 +62,7 @@ void check_argc( const span<char*>& args, size_t curr, const char* err )
   }
 }
 
-tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char*>& args )
+tuple<TCPConfig, FdAdapterConfig, bool, const char*, bool, bool> get_config( const span<char*>& args )
 {
   TCPConfig c_fsm {};
   c_fsm.isn = Wrap32 { random_device()() };
@@ -66,6 +72,8 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
 
   size_t curr = 1;
   bool listen = false;
+  bool use_splice = false;
+  bool mss_set = false;
   const size_t argc = args.size();
 
   string source_address = LOCAL_ADDRESS_DFLT;
@@ -96,6 +104,22 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
       c_fsm.rt_timeout = strtol( args[curr + 1], nullptr, 0 );
       curr += 2;
 
+    } else if ( strncmp( "-m", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -m requires one argument." );
+      // a segment must fit in the largest datagram the tun adapter reads whole
+      const long mss = strtol( args[curr + 1], nullptr, 0 );
+      const long max_mss = TCPConfig::mss_for_mtu( TCPOverIPv4OverTunFdAdapter::MAX_DATAGRAM_SIZE );
+      if ( mss < TCPConfig::MIN_MSS or mss > max_mss ) {
+        show_usage( args[0],
+                    string( "ERROR: -m requires an MSS from " + to_string( TCPConfig::MIN_MSS ) + " to "
+                            + to_string( max_mss ) + " bytes." )
+                      .c_str() );
+        exit( 1 );
+      }
+      c_fsm.mss = static_cast<uint16_t>( mss );
+      mss_set = true;
+      curr += 2;
+
     } else if ( strncmp( "-d", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -t requires one argument." );
       tundev = args[curr + 1];
@@ -117,6 +141,10 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
         = static_cast<LossRateDnT>( static_cast<float>( numeric_limits<LossRateDnT>::max() ) * lossrate );
       curr += 2;
 
+    } else if ( strncmp( "-z", args[curr], 3 ) == 0 ) {
+      use_splice = true;
+      curr += 1;
+
     } else if ( strncmp( "-h", args[curr], 3 ) == 0 ) {
       show_usage( args[0], nullptr );
       exit( 0 );
@@ -139,7 +167,7 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
     c_filt.source = { source_address, source_port };
   }
 
-  return make_tuple( c_fsm, c_filt, listen, tundev );
+  return make_tuple( c_fsm, c_filt, listen, tundev, use_splice, mss_set );
 }
 } // namespace
 
@@ -157,9 +185,14 @@ int main( int argc, char** argv )
       return EXIT_FAILURE;
     }
 
-    auto [c_fsm, c_filt, listen, tun_dev_name] = get_config( args );
-    LossyTCPOverIPv4MinnowSocket tcp_socket( LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>(
-      TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ) ) );
+    auto [c_fsm, c_filt, listen, tun_dev_name, use_splice, mss_set] = get_config( args );
+    TunFD tun { tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name };
+    if ( not mss_set ) {
+      c_fsm.mss
+        = TCPConfig::mss_for_mtu( min( tun.mtu(), TCPOverIPv4OverTunFdAdapter::MAX_DATAGRAM_SIZE ) );
+    }
+    LossyTCPOverIPv4MinnowSocket tcp_socket(
+      LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>( TCPOverIPv4OverTunFdAdapter( std::move( tun ) ) ) );
 
     if ( listen ) {
       tcp_socket.listen_and_accept( c_fsm, c_filt );
@@ -167,7 +200,7 @@ int main( int argc, char** argv )
       tcp_socket.connect( c_fsm, c_filt );
     }
 
-    bidirectional_stream_copy( tcp_socket, tcp_socket.peer_address().to_string() );
+    bidirectional_stream_copy( tcp_socket, tcp_socket.peer_address().to_string(), use_splice );
     tcp_socket.wait_until_closed();
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
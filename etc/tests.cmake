@@ -23,6 +23,9 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_storage)
+ttest(byte_stream_spsc)
+ttest(buffer_pool)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -37,10 +40,12 @@ ttest(wrapping_integers_wrap)
 ttest(wrapping_integers_unwrap)
 ttest(wrapping_integers_roundtrip)
 ttest(wrapping_integers_extra)
+ttest(wrapping_integers_serial)
 
 ttest(recv_connect)
 ttest(recv_transmit)
 ttest(recv_window)
+ttest(recv_timestamps)
 ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
@@ -53,6 +58,16 @@ ttest(send_ack)
 ttest(send_close)
 ttest(send_retx)
 ttest(send_extra)
+ttest(send_rto)
+ttest(send_congestion)
+ttest(send_fast_retransmit)
+ttest(send_sack)
+ttest(send_window_scale)
+ttest(send_timestamps)
+ttest(send_mss)
+ttest(tcp_segment_options)
+ttest(tcp_direct_streams)
+ttest(stream_copy_splice)
 
 ttest(net_interface)
 
@@ -80,6 +95,16 @@ add_custom_target (check6 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --s
 
 add_custom_target (speed COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 15 -R '_speed_test')
 
+add_custom_target (benchmark
+  COMMAND byte_stream_benchmark --json "${CMAKE_BINARY_DIR}/byte_stream_benchmark.json"
+                                --csv "${CMAKE_BINARY_DIR}/byte_stream_benchmark.csv"
+  COMMAND reassembler_benchmark --json "${CMAKE_BINARY_DIR}/reassembler_benchmark.json"
+                                --csv "${CMAKE_BINARY_DIR}/reassembler_benchmark.csv"
+  COMMAND wrapping_integers_benchmark --json "${CMAKE_BINARY_DIR}/wrapping_integers_benchmark.json"
+                                      --csv "${CMAKE_BINARY_DIR}/wrapping_integers_benchmark.csv"
+  COMMAND congestion_benchmark --json "${CMAKE_BINARY_DIR}/congestion_benchmark.json"
+                               --csv "${CMAKE_BINARY_DIR}/congestion_benchmark.csv")
+
 set(compile_name_opt "compile with optimization")
 add_test(NAME ${compile_name_opt}
   COMMAND "${CMAKE_COMMAND}" --build "${CMAKE_BINARY_DIR}" -t speed_testing)
@@ -1,19 +1,214 @@
 #include "byte_stream.hh"
+#include "exception.hh"
+
 #include <algorithm>
 #include <cstdint>
 #include <cstdio>
+#include <iterator>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ), stream_start_(0) {}
+namespace {
+/* Pushes smaller than this are appended to the newest chunk when it has spare room, instead of becoming a chunk */
+constexpr uint64_t kMinAdoptedChunkSize = 512;
+/* Spilled: how many of the most recently pushed bytes are left resident when older ones are written out */
+constexpr uint64_t kSpillHotWindow = 4 << 20;
+/* Spilled: bytes are written out and discarded in aligned batches of this size (a multiple of the page size) */
+constexpr uint64_t kSpillBatch = 1 << 20;
+} // namespace
+
+ByteStream::ByteStream( uint64_t capacity, Storage storage )
+  : capacity_( capacity ), storage_( storage ), buffer_( storage == Storage::Ring ? capacity : 0, '\0' )
+{
+  if ( storage_ == Storage::Mirrored ) {
+    try {
+      mirror_ = MirroredBuffer( capacity_ );
+    } catch ( const unix_error& ) {
+      /* No memfd (or mmap failed): keep the same semantics with a plain ring */
+      storage_ = Storage::Ring;
+      buffer_.resize( capacity_ );
+    }
+  }
+  /* No fallback for Spilled: keeping `capacity_` bytes in memory is exactly what it is asked to avoid */
+  if ( storage_ == Storage::Spilled ) {
+    mirror_ = MirroredBuffer( capacity_, MirroredBuffer::Backing::TempFile );
+  }
+}
 
 void Writer::push( string data )
 {
-  uint64_t add_num = min(available_capacity(), data.size());
-  buffer_.append(data, 0, add_num);
+  reserved_ = 0;
+  const uint64_t add_num = min( available_capacity(), data.size() );
+  if ( add_num == 0 ) {
+    return;
+  }
+
+  switch ( storage_ ) {
+    case Storage::Ring:
+      push_ring( string_view( data ).substr( 0, add_num ) );
+      break;
+    case Storage::Chunked:
+      data.resize( add_num );
+      push_chunked( move( data ) );
+      break;
+    case Storage::Mirrored:
+    case Storage::Spilled:
+      push_mirrored( string_view( data ).substr( 0, add_num ) );
+      break;
+    default:
+      throw runtime_error( "Invalid ByteStream storage" );
+  }
   write_byte_num_ += add_num;
+  if ( storage_ == Storage::Spilled ) {
+    spill();
+  }
+}
+
+void Writer::push_ring( string_view data )
+{
+  /* Copy into the tail of the ring, wrapping around to the front of the storage if necessary */
+  const uint64_t tail = ( stream_start_ + write_byte_num_ - read_byte_num_ ) % capacity_;
+  const uint64_t first_part = min( data.size(), capacity_ - tail );
+  data.copy( buffer_.data() + tail, first_part );
+  data.copy( buffer_.data(), data.size() - first_part, first_part );
+}
+
+void Writer::push_mirrored( string_view data )
+{
+  /* The tail is contiguous for up to mirror_.size() bytes, so there's never a second copy for the wrap */
+  const uint64_t tail = ( stream_start_ + write_byte_num_ - read_byte_num_ ) % mirror_.size();
+  data.copy( mirror_.data() + tail, data.size() );
+}
+
+void Writer::spill()
+{
+  /* Write out (and drop from memory) each whole batch of buffered bytes that falls behind the hot window */
+  const uint64_t hot_start
+    = write_byte_num_ > kSpillHotWindow ? ( write_byte_num_ - kSpillHotWindow ) / kSpillBatch * kSpillBatch : 0;
+  if ( hot_start <= paged_out_ ) {
+    return;
+  }
+  const uint64_t from = max( paged_out_, read_byte_num_ );
+  if ( from < hot_start ) {
+    mirror_.page_out( from % mirror_.size(), hot_start - from );
+  }
+  paged_out_ = hot_start;
+}
+
+void Writer::push_chunked( string&& data )
+{
+  /* A small write goes into the newest chunk's spare capacity when it fits there, so a trickle of bytes mostly
+   * fills existing chunks; otherwise it becomes a chunk of its own like any other write */
+  if ( data.size() < kMinAdoptedChunkSize && !chunks_.empty() && chunks_.back().spare() >= data.size()
+       && chunks_.back().block.use_count() <= 1 ) {
+    Chunk& back = chunks_.back();
+    if ( back.block.size() ) {
+      data.copy( back.block.data() + back.block_used, data.size() );
+      back.block_used += data.size();
+    } else {
+      back.str.append( data );
+    }
+    return;
+  }
+  /* Don't let a mostly-empty read buffer pin its whole allocation for as long as its bytes stay buffered */
+  if ( data.capacity() / 2 > data.size() ) {
+    data.shrink_to_fit();
+  }
+  chunks_.push_back( { .str = move( data ) } );
+  chunk_pos_.push_back( write_byte_num_ );
+}
+
+/**
+ * @return spans to be filled in place (e.g. by FileDescriptor::read) and then published with commit():
+ * the free space after the ring's tail (two spans when it wraps; always one for Mirrored/Spilled),
+ * or for Chunked, the rest of the newest chunk's pool block if it has enough room, else a fresh
+ * (uninitialized) block sized to the request, up to the pool's largest block
+ */
+vector<span<char>> Writer::reserve( uint64_t len )
+{
+  reserved_ = min( len, available_capacity() );
+  vector<span<char>> spans;
+  if ( reserved_ == 0 ) {
+    return spans;
+  }
+
+  switch ( storage_ ) {
+    case Storage::Ring: {
+      const uint64_t tail = ( stream_start_ + write_byte_num_ - read_byte_num_ ) % capacity_;
+      const uint64_t first_part = min( reserved_, capacity_ - tail );
+      spans.emplace_back( buffer_.data() + tail, first_part );
+      if ( first_part < reserved_ ) {
+        spans.emplace_back( buffer_.data(), reserved_ - first_part );
+      }
+      break;
+    }
+    case Storage::Chunked: {
+      reserved_ = min( reserved_, uint64_t { Buffer::kMaxPooledSize } );
+      /* (a block shared with a copy of this stream is never written again) */
+      if ( !chunks_.empty() && chunks_.back().block.use_count() == 1
+           && chunks_.back().spare() >= min( reserved_, kMinAdoptedChunkSize ) ) {
+        Chunk& back = chunks_.back();
+        reserved_ = min( reserved_, back.spare() );
+        reserved_block_ = Buffer();
+        spans.emplace_back( back.block.data() + back.block_used, reserved_ );
+        break;
+      }
+      if ( reserved_block_.size() < reserved_ ) {
+        reserved_block_ = Buffer( reserved_ );
+      }
+      spans.emplace_back( reserved_block_.data(), reserved_ );
+      break;
+    }
+    case Storage::Mirrored:
+    case Storage::Spilled: {
+      const uint64_t tail = ( stream_start_ + write_byte_num_ - read_byte_num_ ) % mirror_.size();
+      spans.emplace_back( mirror_.data() + tail, reserved_ );
+      break;
+    }
+    default:
+      throw runtime_error( "Invalid ByteStream storage" );
+  }
+  return spans;
+}
+
+void Writer::commit( uint64_t len )
+{
+  if ( len > reserved_ ) {
+    throw runtime_error( "Writer::commit() of more bytes than were reserved" );
+  }
+  reserved_ = 0;
+  if ( len == 0 ) {
+    return;
+  }
+
+  switch ( storage_ ) {
+    case Storage::Ring:
+    case Storage::Mirrored:
+    case Storage::Spilled:
+      break;
+    case Storage::Chunked:
+      /* The bytes are already in place: either in the newest chunk's block, or in a block that becomes a chunk */
+      if ( reserved_block_.size() == 0 ) {
+        chunks_.back().block_used += len;
+        break;
+      }
+      chunks_.push_back( { .block = move( reserved_block_ ), .block_used = len } );
+      chunk_pos_.push_back( write_byte_num_ );
+      reserved_block_ = Buffer();
+      break;
+    default:
+      throw runtime_error( "Invalid ByteStream storage" );
+  }
+  write_byte_num_ += len;
+  if ( storage_ == Storage::Spilled ) {
+    spill();
+  }
 }
 
 void Writer::close()
@@ -28,7 +223,7 @@ bool Writer::is_closed() const
 
 uint64_t Writer::available_capacity() const
 {
-  return capacity_ - ( buffer_.size() - stream_start_ );
+  return capacity_ - ( write_byte_num_ - read_byte_num_ );
 }
 
 uint64_t Writer::bytes_pushed() const
@@ -40,30 +235,213 @@ uint64_t Writer::bytes_pushed() const
 
 string_view Reader::peek() const
 {
-  return string_view(buffer_.data() + stream_start_, buffer_.size() - stream_start_);
+  return peek( 0 );
+}
+
+/**
+ * @return the contiguous run of buffered bytes starting at `offset`: up to the wrap point (Ring),
+ * to the end of the chunk holding that byte (Chunked) or all the rest of the buffered bytes (Mirrored/Spilled);
+ * empty if `offset` is past the buffered bytes
+ */
+string_view Reader::peek( uint64_t offset ) const
+{
+  if ( offset >= bytes_buffered() ) {
+    return {};
+  }
+
+  switch ( storage_ ) {
+    case Storage::Ring:
+      return peek_ring( offset );
+    case Storage::Chunked:
+      return peek_chunked( offset );
+    case Storage::Mirrored:
+    case Storage::Spilled:
+      return peek_mirrored( offset );
+    default:
+      throw runtime_error( "Invalid ByteStream storage" );
+  }
+}
+
+string_view Reader::peek_ring( uint64_t offset ) const
+{
+  const uint64_t start = ( stream_start_ + offset ) % capacity_;
+  return { buffer_.data() + start, min( bytes_buffered() - offset, capacity_ - start ) };
+}
+
+/* Binary search on the chunks' start indices, so that peeking deep into a long queue stays cheap */
+string_view Reader::peek_chunked( uint64_t offset ) const
+{
+  const uint64_t index = read_byte_num_ + offset;
+  const auto after = upper_bound( chunk_pos_.begin(), chunk_pos_.end(), index );
+  if ( after == chunk_pos_.begin() || index >= write_byte_num_ ) {
+    throw runtime_error( "ByteStream chunks are shorter than bytes_buffered()" );
+  }
+  const auto chunk = prev( after ) - chunk_pos_.begin();
+  return chunks_[chunk].bytes().substr( index - chunk_pos_[chunk] );
+}
+
+string_view Reader::peek_mirrored( uint64_t offset ) const
+{
+  const uint64_t start = ( stream_start_ + offset ) % mirror_.size();
+  return { mirror_.data() + start, bytes_buffered() - offset };
+}
+
+/**
+ * @return all buffered bytes in order, as the contiguous regions of the storage (ready for writev):
+ * at most two for Ring (before and after the wrap point), one per chunk for Chunked,
+ * one for Mirrored/Spilled
+ */
+vector<string_view> Reader::peek_all() const
+{
+  vector<string_view> regions;
+  if ( bytes_buffered() == 0 ) {
+    return regions;
+  }
+
+  switch ( storage_ ) {
+    case Storage::Ring: {
+      const string_view first = peek_ring( 0 );
+      regions.push_back( first );
+      if ( first.size() < bytes_buffered() ) {
+        regions.push_back( peek_ring( first.size() ) );
+      }
+      break;
+    }
+    case Storage::Chunked:
+      regions.reserve( chunks_.size() );
+      regions.emplace_back( chunks_.front().bytes().substr( stream_start_ ) );
+      for ( auto it = next( chunks_.begin() ); it != chunks_.end(); ++it ) {
+        regions.emplace_back( it->bytes() );
+      }
+      break;
+    case Storage::Mirrored:
+    case Storage::Spilled:
+      regions.push_back( peek_mirrored( 0 ) );
+      break;
+    default:
+      throw runtime_error( "Invalid ByteStream storage" );
+  }
+  return regions;
+}
+
+/**
+ * Chunked: if the `len` bytes starting `offset` bytes past the next one are exactly one whole pushed chunk,
+ * move that chunk into `into` (with no copy) and leave its place empty. The returned loan moves it back when it
+ * is destroyed, even if the stack is unwinding, and the stream must not be used before then.
+ * @return the loan, which is empty if those bytes aren't a whole chunk (or the storage isn't Chunked)
+ */
+Reader::ChunkLoan Reader::lend_chunk( uint64_t offset, uint64_t len, string& into )
+{
+  if ( storage_ != Storage::Chunked || len == 0 || offset + len > bytes_buffered() ) {
+    return {};
+  }
+  const uint64_t index = read_byte_num_ + offset;
+  const auto start = lower_bound( chunk_pos_.begin(), chunk_pos_.end(), index );
+  if ( start == chunk_pos_.end() || *start != index ) {
+    return {};
+  }
+  /* Only a pushed string can be handed over as one; a block filled through reserve() stays where it is */
+  Chunk& chunk = chunks_[start - chunk_pos_.begin()];
+  if ( chunk.block.size() || chunk.str.size() != len ) {
+    return {};
+  }
+  into = exchange( chunk.str, string() );
+  return { *this, index, into };
+}
+
+Reader::ChunkLoan::ChunkLoan( ChunkLoan&& other ) noexcept
+  : reader_( exchange( other.reader_, nullptr ) ), index_( other.index_ ), into_( other.into_ )
+{}
+
+Reader::ChunkLoan::~ChunkLoan()
+{
+  if ( reader_ == nullptr ) {
+    return;
+  }
+  const auto start = lower_bound( reader_->chunk_pos_.begin(), reader_->chunk_pos_.end(), index_ );
+  if ( start != reader_->chunk_pos_.end() && *start == index_ ) {
+    reader_->chunks_[start - reader_->chunk_pos_.begin()].str = move( *into_ );
+  }
 }
 
 void Reader::pop( uint64_t len )
 {
-  stream_start_ += len;
-  if (stream_start_ >= buffer_.size() / 2) {
-    buffer_.erase(0, stream_start_);
-    stream_start_ = 0;
+  len = min( len, bytes_buffered() );
+  if ( len == 0 ) {
+    return;
+  }
+
+  switch ( storage_ ) {
+    case Storage::Ring:
+      pop_ring( len );
+      break;
+    case Storage::Chunked:
+      pop_chunked( len );
+      break;
+    case Storage::Mirrored:
+    case Storage::Spilled:
+      pop_mirrored( len );
+      break;
+    default:
+      throw runtime_error( "Invalid ByteStream storage" );
   }
   read_byte_num_ += len;
+  if ( storage_ == Storage::Spilled ) {
+    discard_popped();
+  }
+}
+
+void Reader::pop_ring( uint64_t len )
+{
+  /* Restart from the front when drained so that the next pushes stay contiguous */
+  stream_start_ = len == bytes_buffered() ? 0 : ( stream_start_ + len ) % capacity_;
+}
+
+void Reader::pop_chunked( uint64_t len )
+{
+  /* Release every chunk that is fully consumed, then advance into the new front chunk */
+  while ( len > 0 ) {
+    const uint64_t front_remaining = chunks_.front().bytes().size() - stream_start_;
+    if ( len < front_remaining ) {
+      stream_start_ += len;
+      return;
+    }
+    len -= front_remaining;
+    chunks_.pop_front();
+    chunk_pos_.pop_front();
+    stream_start_ = 0;
+  }
+}
+
+void Reader::pop_mirrored( uint64_t len )
+{
+  stream_start_ = ( stream_start_ + len ) % mirror_.size();
+}
+
+void Reader::discard_popped()
+{
+  /* Popped bytes never need to reach the disk. Skip the part of the file that the writer has already
+   * reused (or reserved) for newer bytes, which starts one buffer size after each popped byte. */
+  const uint64_t reused_end = max( write_byte_num_ + reserved_, mirror_.size() ) - mirror_.size();
+  const uint64_t from = max( discarded_, reused_end );
+  const uint64_t to = read_byte_num_ / kSpillBatch * kSpillBatch;
+  if ( from < to ) {
+    mirror_.discard( from % mirror_.size(), to - from );
+  }
+  discarded_ = max( discarded_, to );
 }
 
 bool Reader::is_finished() const
 {
-  return closed_ && buffer_.size() - stream_start_ == 0 ; // Your code here.
+  return closed_ && bytes_buffered() == 0;
 }
 
 uint64_t Reader::bytes_buffered() const
 {
-  return buffer_.size() - stream_start_; // Your code here.
+  return write_byte_num_ - read_byte_num_;
 }
 
 uint64_t Reader::bytes_popped() const
 {
-  return read_byte_num_; // Your code here.
+  return read_byte_num_;
 }
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "buffer_pool.hh"
+#include "mirrored_buffer.hh"
+
 #include <cstdint>
+#include <deque>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 class Reader;
 class Writer;
@@ -10,7 +16,18 @@ class Writer;
 class ByteStream
 {
 public:
-  explicit ByteStream( uint64_t capacity );
+  // How the ByteStream keeps the bytes that have been pushed but not yet popped
+  enum class Storage : uint8_t
+  {
+    Ring,     // Copy pushed bytes into a fixed-size circular buffer
+    Chunked,  // Adopt each pushed string whole and keep a queue of owned chunks (no copy of moved-in strings)
+    Mirrored, // Like Ring, but with the storage mapped twice back to back so the buffered bytes are always
+              // contiguous (Linux-only; falls back to Ring if the mapping can't be made)
+    Spilled,  // Like Mirrored, but backed by a temporary file: only the newest bytes stay resident, older
+              // buffered bytes are written out to disk and paged back in when read (Linux-only)
+  };
+
+  explicit ByteStream( uint64_t capacity, Storage storage = Storage::Ring );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -21,13 +38,35 @@ public:
   void set_error() { error_ = true; };       // Signal that the stream suffered an error.
   bool has_error() const { return error_; }; // Has the stream had an error?
 
+  Storage storage() const { return storage_; }
+
 protected:
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
   uint64_t capacity_;
+  Storage storage_;
   uint64_t write_byte_num_ {};
   uint64_t read_byte_num_ {};
-  uint64_t stream_start_ {};
-  std::string buffer_ {};
+  uint64_t stream_start_ {};          // Ring: offset of the first buffered byte within buffer_
+                                      // Chunked: offset of the first buffered byte within chunks_.front()
+                                      // Mirrored/Spilled: offset of the first buffered byte within mirror_
+  PooledBytes buffer_ {};             // Ring: fixed-size circular storage, allocated once with `capacity_` bytes
+  MirroredBuffer mirror_ {};          // Mirrored/Spilled: `capacity_` rounded up to whole pages, mapped twice
+  uint64_t paged_out_ {};             // Spilled: bytes before this stream index have been written out to disk
+  uint64_t discarded_ {};             // Spilled: bytes before this stream index have been dropped from the file
+  // Chunked: a pushed string adopted whole, or a pool block that Writer::reserve() handed out to be filled in place
+  struct Chunk
+  {
+    std::string str {};
+    Buffer block {};
+    uint64_t block_used {}; // bytes committed into `block`
+
+    std::string_view bytes() const { return block.size() ? std::string_view { block.data(), block_used } : str; }
+    uint64_t spare() const { return block.size() ? block.size() - block_used : str.capacity() - str.size(); }
+  };
+  std::deque<Chunk> chunks_ {};       // Chunked: the buffered chunks, oldest first
+  std::deque<uint64_t> chunk_pos_ {}; // Chunked: stream index of the first byte of each chunk
+  Buffer reserved_block_ {};          // Chunked: a block handed out by Writer::reserve() but not yet committed
+  uint64_t reserved_ {};              // Number of bytes handed out by Writer::reserve() but not yet committed
   bool closed_ {};
   bool error_ {};
 };
@@ -38,20 +77,70 @@ public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
+  // Writable spans inside the stream's storage for up to `len` bytes (as much as available capacity allows, and
+  // for Chunked, no more than one pool block). They stay valid until the next push(), reserve() or commit().
+  std::vector<std::span<char>> reserve( uint64_t len );
+  void commit( uint64_t len ); // Publish the first `len` bytes written into the spans from reserve()
+
   bool is_closed() const;              // Has the stream been closed?
   uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+
+private:
+  void push_ring( std::string_view data );
+  void push_mirrored( std::string_view data );
+  void push_chunked( std::string&& data );
+  void spill();
 };
 
 class Reader : public ByteStream
 {
 public:
-  std::string_view peek() const; // Peek at the next bytes in the buffer
-  void pop( uint64_t len );      // Remove `len` bytes from the buffer
+  std::string_view peek() const;                  // Peek at the next contiguous bytes in the buffer
+  std::string_view peek( uint64_t offset ) const; // Peek at the bytes starting `offset` bytes past the next one
+  std::vector<std::string_view> peek_all() const; // Peek at every buffered byte, one view per contiguous region
+  void pop( uint64_t len );                       // Remove `len` bytes from the buffer
+
+  // Chunked: a chunk moved out of the stream into a caller's string, and moved back when the loan ends
+  class ChunkLoan
+  {
+  public:
+    ChunkLoan() = default;
+    ChunkLoan( ChunkLoan&& other ) noexcept;
+    ChunkLoan( const ChunkLoan& other ) = delete;
+    ChunkLoan& operator=( ChunkLoan&& other ) = delete;
+    ChunkLoan& operator=( const ChunkLoan& other ) = delete;
+    ~ChunkLoan();
+
+    explicit operator bool() const { return reader_ != nullptr; } // Was a chunk lent?
+
+  private:
+    friend class Reader;
+    ChunkLoan( Reader& reader, uint64_t index, std::string& into )
+      : reader_( &reader ), index_( index ), into_( &into )
+    {}
+
+    Reader* reader_ {};
+    uint64_t index_ {};    // stream index of the chunk's first byte
+    std::string* into_ {}; // where the chunk is while lent
+  };
+
+  // Chunked: lend the chunk holding exactly the `len` bytes at `offset` (if they are one whole chunk) by moving it
+  // into `into`; the stream must not be used until the loan ends
+  ChunkLoan lend_chunk( uint64_t offset, uint64_t len, std::string& into );
 
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
   uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
   uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+
+private:
+  std::string_view peek_ring( uint64_t offset ) const;
+  std::string_view peek_chunked( uint64_t offset ) const;
+  std::string_view peek_mirrored( uint64_t offset ) const;
+  void pop_ring( uint64_t len );
+  void pop_chunked( uint64_t len );
+  void pop_mirrored( uint64_t len );
+  void discard_popped();
 };
 
 /*
@@ -0,0 +1,181 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+// RFC 5681 initial window: min( 4*SMSS, max( 2*SMSS, 4380 bytes ) )
+uint64_t initial_window( uint64_t mss )
+{
+  return min( 4 * mss, max( 2 * mss, uint64_t { 4380 } ) );
+}
+} // namespace
+
+unique_ptr<CongestionControl> CongestionControl::make( Algorithm algorithm, uint64_t mss )
+{
+  switch ( algorithm ) {
+    case Algorithm::NewReno:
+      return make_unique<NewReno>( mss );
+    case Algorithm::Cubic:
+      return make_unique<Cubic>( mss );
+    case Algorithm::None:
+      break;
+  }
+  return nullptr;
+}
+
+CongestionControl::CongestionControl( uint64_t mss ) : mss_( mss ), cwnd_( initial_window( mss ) ) {}
+
+void CongestionControl::on_send( uint64_t /* bytes */, uint64_t /* bytes_in_flight */, uint64_t /* now_ms */ ) {}
+
+void CongestionControl::on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now_ms )
+{
+  on_loss( bytes_in_flight, now_ms );
+  // the three duplicate acks each mean a segment has left the network
+  set_cwnd( cwnd_ + 3 * mss_ );
+}
+
+void CongestionControl::on_duplicate_ack()
+{
+  set_cwnd( cwnd_ + mss_ );
+}
+
+void CongestionControl::on_partial_ack( uint64_t bytes_acked )
+{
+  const uint64_t deflated = cwnd_ > bytes_acked ? cwnd_ - bytes_acked : 0;
+  set_cwnd( max( bytes_acked >= mss_ ? deflated + mss_ : deflated, mss_ ) );
+}
+
+void CongestionControl::on_recovery_exit( uint64_t bytes_in_flight )
+{
+  set_cwnd( min( ssthresh_, max( bytes_in_flight, mss_ ) + mss_ ) );
+}
+
+void NewReno::on_ack( uint64_t bytes_acked,
+                      uint64_t bytes_in_flight,
+                      optional<uint64_t> /* smoothed_rtt_ms */,
+                      uint64_t /* now_ms */ )
+{
+  if ( not window_limited( bytes_in_flight ) ) {
+    return;
+  }
+  if ( in_slow_start() ) {
+    // grow by what was acked, up to one segment per ack
+    cwnd_ += min( bytes_acked, mss_ );
+    return;
+  }
+  // congestion avoidance: one segment per window's worth of acked bytes
+  bytes_acked_ += bytes_acked;
+  if ( bytes_acked_ >= cwnd_ ) {
+    bytes_acked_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void NewReno::on_loss( uint64_t bytes_in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( bytes_in_flight / 2, 2 * mss_ );
+  cwnd_ = ssthresh_;
+  bytes_acked_ = 0;
+}
+
+void NewReno::on_timeout( uint64_t bytes_in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( bytes_in_flight / 2, 2 * mss_ );
+  cwnd_ = mss_; // the loss window
+  bytes_acked_ = 0;
+}
+
+Cubic::Cubic( uint64_t mss )
+  : CongestionControl( mss ), cwnd_segments_( static_cast<double>( cwnd_ ) / static_cast<double>( mss ) )
+{}
+
+void Cubic::set_window( double segments )
+{
+  cwnd_segments_ = max( segments, 1.0 );
+  cwnd_ = static_cast<uint64_t>( cwnd_segments_ * static_cast<double>( mss_ ) );
+}
+
+void Cubic::set_cwnd( uint64_t bytes )
+{
+  set_window( static_cast<double>( bytes ) / static_cast<double>( mss_ ) );
+}
+
+// W_cubic(t) = C * ( t - K )^3 + W_max
+double Cubic::cubic_window( double t_seconds ) const
+{
+  const double offset = t_seconds - k_;
+  return C * offset * offset * offset + w_max_;
+}
+
+void Cubic::on_send( uint64_t /* bytes */, uint64_t bytes_in_flight, uint64_t now_ms )
+{
+  // after an idle period, move the epoch along so the window doesn't jump for time nothing was sent
+  if ( bytes_in_flight == 0 and epoch_start_ms_.has_value() and now_ms > last_send_ms_ ) {
+    *epoch_start_ms_ += now_ms - last_send_ms_;
+  }
+  last_send_ms_ = now_ms;
+}
+
+void Cubic::on_ack( uint64_t bytes_acked,
+                    uint64_t bytes_in_flight,
+                    optional<uint64_t> smoothed_rtt_ms,
+                    uint64_t now_ms )
+{
+  if ( not window_limited( bytes_in_flight ) ) {
+    return;
+  }
+  const double acked_segments = static_cast<double>( bytes_acked ) / static_cast<double>( mss_ );
+  if ( in_slow_start() ) {
+    set_window( cwnd_segments_ + min( acked_segments, 1.0 ) );
+    return;
+  }
+
+  if ( not epoch_start_ms_.has_value() ) {
+    epoch_start_ms_ = now_ms;
+    if ( w_max_ <= cwnd_segments_ ) {
+      // no reduction to recover from (e.g. coming out of slow start): start from the plateau
+      k_ = 0;
+      w_max_ = cwnd_segments_;
+    } else {
+      k_ = cbrt( ( w_max_ - cwnd_segments_ ) / C );
+    }
+    w_est_ = cwnd_segments_;
+  }
+
+  const double t = static_cast<double>( now_ms - *epoch_start_ms_ ) / 1000;
+  const double rtt = static_cast<double>( smoothed_rtt_ms.value_or( 100 ) ) / 1000;
+
+  // the window standard Reno-style AIMD (with the same decrease factor) would have reached
+  const double alpha = w_est_ >= w_max_ ? 1.0 : 3 * ( 1 - BETA ) / ( 1 + BETA );
+  w_est_ += alpha * acked_segments / cwnd_segments_;
+
+  if ( cubic_window( t ) < w_est_ ) {
+    set_window( w_est_ ); // Reno-friendly region
+    return;
+  }
+  // grow towards where the cubic will be one RTT from now, by at most half the window per RTT
+  const double target = clamp( cubic_window( t + rtt ), cwnd_segments_, 1.5 * cwnd_segments_ );
+  set_window( cwnd_segments_ + ( target - cwnd_segments_ ) / cwnd_segments_ * acked_segments );
+}
+
+void Cubic::reduce( bool timeout )
+{
+  // fast convergence: if the window stopped short of the last plateau, leave room for newer flows
+  w_max_ = cwnd_segments_ < w_max_ ? cwnd_segments_ * ( 1 + BETA ) / 2 : cwnd_segments_;
+  ssthresh_ = max( static_cast<uint64_t>( cwnd_segments_ * BETA * static_cast<double>( mss_ ) ), 2 * mss_ );
+  set_window( timeout ? 1.0 : static_cast<double>( ssthresh_ ) / static_cast<double>( mss_ ) );
+  epoch_start_ms_.reset();
+}
+
+void Cubic::on_loss( uint64_t /* bytes_in_flight */, uint64_t /* now_ms */ )
+{
+  reduce( false );
+}
+
+void Cubic::on_timeout( uint64_t /* bytes_in_flight */, uint64_t /* now_ms */ )
+{
+  reduce( true );
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+/*
+ * A congestion controller keeps the congestion window (cwnd): along with the receiver's window, it bounds
+ * how many sequence numbers the TCPSender keeps in flight. The sender calls the hooks below as it sends new
+ * data, gets acks, and detects losses; times are the sender's clock, in milliseconds.
+ */
+class CongestionControl
+{
+public:
+  enum class Algorithm : uint8_t
+  {
+    None,    // No congestion window: send whatever the receiver's window allows
+    NewReno, // RFC 5681 slow start and congestion avoidance, with RFC 3465 byte counting
+    Cubic,   // RFC 9438
+  };
+
+  // A controller for `algorithm` (or nullptr for Algorithm::None), for segments of up to `mss` bytes
+  static std::unique_ptr<CongestionControl> make( Algorithm algorithm, uint64_t mss );
+
+  explicit CongestionControl( uint64_t mss );
+  virtual ~CongestionControl() = default;
+  CongestionControl( const CongestionControl& other ) = default;
+  CongestionControl& operator=( const CongestionControl& other ) = default;
+
+  // New data (not a retransmission) of `bytes` sequence numbers was sent, with `bytes_in_flight` outstanding
+  // before it
+  virtual void on_send( uint64_t bytes, uint64_t bytes_in_flight, uint64_t now_ms );
+
+  // An ack covered `bytes_acked` new sequence numbers, out of `bytes_in_flight` outstanding before it
+  virtual void on_ack( uint64_t bytes_acked,
+                       uint64_t bytes_in_flight,
+                       std::optional<uint64_t> smoothed_rtt_ms,
+                       uint64_t now_ms )
+    = 0;
+
+  // A loss was detected while the flow kept going (duplicate acks), with `bytes_in_flight` outstanding
+  virtual void on_loss( uint64_t bytes_in_flight, uint64_t now_ms ) = 0;
+
+  // The retransmission timer expired, with `bytes_in_flight` outstanding
+  virtual void on_timeout( uint64_t bytes_in_flight, uint64_t now_ms ) = 0;
+
+  // RFC 6582 fast recovery, the same for every algorithm (only the reduction in on_loss() differs):
+  void on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now_ms ); // on_loss(), then 3 segments more
+  void on_duplicate_ack();                          // one segment more for each that left the network
+  void on_partial_ack( uint64_t bytes_acked );      // take back what was acked, less a segment
+  void on_recovery_exit( uint64_t bytes_in_flight ); // min( ssthresh, max( flight, a segment ) + a segment )
+
+  virtual std::string_view name() const = 0;
+
+  uint64_t window() const { return cwnd_; }
+  uint64_t slow_start_threshold() const { return ssthresh_; }
+  uint64_t mss() const { return mss_; }
+
+protected:
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ = UINT64_MAX;
+
+  bool in_slow_start() const { return cwnd_ < ssthresh_; }
+
+  // Set cwnd (algorithms that keep the window in another form override this to keep it in step)
+  virtual void set_cwnd( uint64_t bytes ) { cwnd_ = bytes; }
+
+  // Was the window what held the sender back? (If not, acks shouldn't grow it: RFC 7661)
+  bool window_limited( uint64_t bytes_in_flight ) const { return bytes_in_flight + mss_ > cwnd_; }
+};
+
+class NewReno : public CongestionControl
+{
+  uint64_t bytes_acked_ {}; // acked in congestion avoidance since cwnd last grew
+
+public:
+  using CongestionControl::CongestionControl;
+
+  void on_ack( uint64_t bytes_acked,
+               uint64_t bytes_in_flight,
+               std::optional<uint64_t> smoothed_rtt_ms,
+               uint64_t now_ms ) override;
+  void on_loss( uint64_t bytes_in_flight, uint64_t now_ms ) override;
+  void on_timeout( uint64_t bytes_in_flight, uint64_t now_ms ) override;
+  std::string_view name() const override { return "NewReno"; }
+};
+
+class Cubic : public CongestionControl
+{
+public:
+  static constexpr double C = 0.4;    // scaling constant of the cubic function, in segments/s^3
+  static constexpr double BETA = 0.7; // multiplicative decrease factor
+
+private:
+  // window sizes are in segments (fractional, so per-ack growth isn't lost to rounding)
+  double cwnd_segments_;
+  double w_max_ {};                          // window before the last reduction
+  double w_est_ {};                          // what Reno would have reached in the same time
+  double k_ {};                              // seconds from the epoch's start until the cubic reaches w_max_
+  std::optional<uint64_t> epoch_start_ms_ {}; // start of the current congestion avoidance epoch
+  uint64_t last_send_ms_ {};
+
+  double cubic_window( double t_seconds ) const;
+  void reduce( bool timeout );
+  void set_window( double segments );
+  void set_cwnd( uint64_t bytes ) override;
+
+public:
+  explicit Cubic( uint64_t mss );
+
+  void on_send( uint64_t bytes, uint64_t bytes_in_flight, uint64_t now_ms ) override;
+  void on_ack( uint64_t bytes_acked,
+               uint64_t bytes_in_flight,
+               std::optional<uint64_t> smoothed_rtt_ms,
+               uint64_t now_ms ) override;
+  void on_loss( uint64_t bytes_in_flight, uint64_t now_ms ) override;
+  void on_timeout( uint64_t bytes_in_flight, uint64_t now_ms ) override;
+  std::string_view name() const override { return "CUBIC"; }
+};
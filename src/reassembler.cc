@@ -1,220 +1,382 @@
 #include "reassembler.hh"
 #include "byte_stream.hh"
 #include <algorithm>
-#include <asm-generic/errno.h>
-#include <cmath>
+#include <bit>
 #include <cstdint>
-#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
 #include <string>
-#include <sys/types.h>
+#include <string_view>
+#include <utility>
 
 using namespace std;
 
-void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
+namespace {
+/* Mask of bits [first, last) of a 64-bit word (0 <= first < last <= 64) */
+uint64_t bit_mask( uint64_t first, uint64_t last )
 {
-  if ( is_capacity_exhausted() ) {
-    return;
-  }
+  const uint64_t below_last = last == 64 ? ~uint64_t {} : ( uint64_t { 1 } << last ) - 1;
+  return below_last & ~( ( uint64_t { 1 } << first ) - 1 );
+}
 
-  if ( is_inserted_out_of_range( first_index, data ) ) {
-    return;
+/* Call `update( word, mask )` for each word of `bits` that holds some of the bits [first, last) */
+template<typename Update>
+void for_each_word( span<uint64_t> bits, uint64_t first, uint64_t last, Update&& update )
+{
+  while ( first < last ) {
+    const uint64_t word_end = min( last, ( first / 64 + 1 ) * 64 );
+    update( bits[first / 64], bit_mask( first % 64, word_end - first / 64 * 64 ) );
+    first = word_end;
   }
+}
 
-  if ( data.empty() && !is_last_substring ) {
-    return;
+/* How many consecutive bits of `bits` from `bit` on (at most `limit`) equal `value` */
+uint64_t bit_run( span<const uint64_t> bits, uint64_t bit, uint64_t limit, bool value )
+{
+  /* Scan a word at a time for the first bit that differs */
+  uint64_t run = 0;
+  while ( run < limit ) {
+    const uint64_t at = bit + run;
+    const uint64_t differs = ( value ? ~bits[at / 64] : bits[at / 64] ) >> ( at % 64 );
+    if ( differs != 0 ) {
+      run += countr_zero( differs );
+      break;
+    }
+    run += 64 - at % 64;
   }
+  return min( run, limit );
+}
 
-  if ( is_already_buffered( first_index, data ) ) {
-    return;
+/* How many consecutive bits of `bits` just before `bit` (at most `limit` <= `bit`) equal `value` */
+uint64_t bit_run_before( span<const uint64_t> bits, uint64_t bit, uint64_t limit, bool value )
+{
+  uint64_t run = 0;
+  while ( run < limit ) {
+    const uint64_t at = bit - run - 1;
+    const uint64_t differs = ( value ? ~bits[at / 64] : bits[at / 64] ) << ( 63 - at % 64 );
+    if ( differs != 0 ) {
+      run += countl_zero( differs );
+      break;
+    }
+    run += at % 64 + 1;
   }
+  return min( run, limit );
+}
 
-  trim_to_fit( first_index, data, is_last_substring );
+/* Window blocks come from the pool's smallest blocks */
+const int kWindowBlockClass = BufferPool::size_class( BufferPool::kBlockSizes.front() );
+} // namespace
 
-  /* Push bytes into the stream */
-  if ( is_match_first_index( first_index ) ) {
-    handle_match_first_index( data, is_last_substring );
+void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
+{
+  /* Bytes at or past window_end() don't fit in the output even once every gap is filled */
+  const uint64_t limit = window_end();
+  if ( first_index > limit ) {
+    drops_.beyond_window += data.size();
+    drops_.segments += !data.empty();
     return;
   }
+  const uint64_t last_index = first_index + data.size();
+  if ( is_last_substring && last_index <= limit ) {
+    end_index_ = last_index;
+  }
 
-  buffer_in_assembler( first_index, data, is_last_substring );
+  /* [...already reassembled...) [reassembled_first_index_ ... window) [...beyond capacity...] */
+  const uint64_t begin = max( first_index, reassembled_first_index_ );
+  const uint64_t end = min( last_index, limit );
+  const DropCounters drops_before = drops_;
+  drops_.beyond_window += last_index - max( end, first_index );
+  if ( begin == reassembled_first_index_ && begin < end ) {
+    /* In order: push the segment straight to the output (which may adopt the string without copying) */
+    data.resize( end - first_index );
+    data.erase( 0, begin - first_index );
+    forget( begin, end - begin );
+    output_.writer().push( move( data ) );
+    reassembled_first_index_ = end;
+  } else if ( begin < end ) {
+    store_within_limit( begin, string_view( data ).substr( begin - first_index, end - begin ) );
+  }
+  if ( drops_.beyond_window + drops_.over_limit + drops_.evicted
+       != drops_before.beyond_window + drops_before.over_limit + drops_before.evicted ) {
+    ++drops_.segments;
+  }
+  push_stored();
 }
 
-bool Reassembler::is_inserted_out_of_range( const uint64_t index, const string& data ) const
+Reassembler::BlockPtr Reassembler::WindowBlock::make()
 {
-  const uint64_t assembled_max_index = reassembled_first_index_ + writer().available_capacity() - 1;
-  const uint64_t max_index = calculate_max_index( index, data );
-  /* [...data...max_index] [--range--] [min_index...data...] */
-  return max_index < reassembled_first_index_ || index > assembled_max_index;
+  /* The bytes are left uninitialized: only those marked present are ever read */
+  BlockPtr block { new ( BufferPool::allocate( kWindowBlockClass ) ) WindowBlock };
+  block->present.fill( 0 );
+  block->stored = 0;
+  return block;
 }
 
-inline uint64_t Reassembler::calculate_max_index( uint64_t index, const std::string& data ) const
+void Reassembler::WindowBlock::Release::operator()( WindowBlock* block ) const
 {
-  return index + ( data.size() == 0 ? 0 : data.size() - 1 );
+  BufferPool::deallocate( block, kWindowBlockClass );
 }
 
-bool Reassembler::is_already_buffered( const uint64_t first_index, const std::string& data ) const
+template<typename Visit>
+void Reassembler::for_each_block_run( uint64_t first_index, uint64_t len, Visit&& visit ) const
 {
-  const uint64_t max_index = calculate_max_index( first_index, data );
-  const int packet_index = find_the_contain_packet( first_index );
-  if ( packet_index == -1 ) {
-    return false;
+  /* A run ends at the end of a block, or at the end of the window (where the slots wrap around) */
+  uint64_t offset = 0;
+  while ( offset < len ) {
+    const uint64_t slot = ( first_index + offset ) % window_size_;
+    const uint64_t in_block = slot % WindowBlock::kSize;
+    const uint64_t n = min( { len - offset, WindowBlock::kSize - in_block, window_size_ - slot } );
+    if ( !visit( slot / WindowBlock::kSize, in_block, n, offset ) ) {
+      return;
+    }
+    offset += n;
   }
+}
 
-  auto it = buffer_.find( packet_index );
-  const uint64_t max_packet_index = calculate_max_index( packet_index, it->second.data );
-  return static_cast<uint64_t>( it->first ) <= first_index && max_index <= max_packet_index;
+uint64_t Reassembler::block_limit() const
+{
+  /* The table of blocks counts against the memory limit too, but one block can always be held */
+  const uint64_t table = blocks_.capacity() * sizeof( BlockPtr );
+  return max<uint64_t>( 1, ( memory_limit_ - min( memory_limit_, table ) ) / BufferPool::kBlockSizes.front() );
 }
 
-void Reassembler::buffer_insertion( const uint64_t first_index, const string& data, bool is_last_substring )
+uint64_t Reassembler::missing_blocks( uint64_t first_index, uint64_t len ) const
 {
-  const int packet_index = find_the_contain_packet( first_index );
-  if ( packet_index < 0 ) {
-    buffer_.insert( { first_index, ReassemblePacket { data, is_last_substring } } );
-    merge_overlap_from( first_index );
+  uint64_t count = 0;
+  for_each_block_run( first_index, len, [&]( uint64_t block, uint64_t, uint64_t, uint64_t ) {
+    count += !blocks_[block];
+    return true;
+  } );
+  return count;
+}
+
+void Reassembler::store_within_limit( uint64_t first_index, string_view data )
+{
+  if ( blocks_.empty() ) {
+    blocks_.resize( ( window_size_ + WindowBlock::kSize - 1 ) / WindowBlock::kSize );
+  }
+  const uint64_t new_blocks = missing_blocks( first_index, data.size() );
+  if ( bytes_pending_ + data.size() <= memory_limit_ && blocks_held_ + new_blocks <= block_limit() ) {
+    store( first_index, data );
     return;
   }
 
-  /* Discard old_data if it's fully contained in new_data with the same start index */
-  auto it = buffer_.find( packet_index );
-  ReassemblePacket& packet = it->second;
-  if ( static_cast<uint64_t>( packet_index ) == first_index ) {
-    if ( packet.data.size() < data.size() ) {
-      buffer_.erase( it );
-    }
+  /* Only the bytes not already stored count against the limit */
+  uint64_t missing = 0;
+  for ( uint64_t i = stored_run( first_index, data.size() ); i < data.size(); ) {
+    const uint64_t run = stored_run( first_index + i, data.size() - i, false );
+    missing += run;
+    i += run;
+    i += stored_run( first_index + i, data.size() - i );
+  }
+  if ( drop_policy_ == DropPolicy::Farthest ) {
+    const uint64_t excess = bytes_pending_ + missing - min( memory_limit_, bytes_pending_ + missing );
+    evict_farthest( first_index + data.size(), excess, new_blocks );
   }
 
-  buffer_.insert( { first_index, ReassemblePacket { data, is_last_substring } } );
-  merge_overlap_from( std::min<uint64_t>( packet_index, first_index ) );
+  /* Keep the longest prefix whose missing bytes, and the blocks they go in, fit */
+  uint64_t budget = memory_limit_ - min( memory_limit_, bytes_pending_ );
+  uint64_t block_budget = block_limit() - min( block_limit(), blocks_held_ );
+  uint64_t len = 0;
+  for_each_block_run( first_index, data.size(), [&]( uint64_t block, uint64_t, uint64_t n, uint64_t offset ) {
+    if ( !blocks_[block] ) {
+      if ( block_budget == 0 || budget == 0 ) {
+        return false;
+      }
+      --block_budget;
+      len = offset + min( n, budget );
+      budget -= len - offset;
+      return len == offset + n;
+    }
+    while ( len < offset + n ) {
+      len += stored_run( first_index + len, offset + n - len );
+      const uint64_t run = stored_run( first_index + len, offset + n - len, false );
+      len += min( run, budget );
+      if ( run > budget ) {
+        return false;
+      }
+      budget -= run;
+    }
+    return true;
+  } );
+  const uint64_t pending_before = bytes_pending_;
+  if ( len > 0 ) {
+    store( first_index, data.substr( 0, len ) );
+  }
+  drops_.over_limit += missing - ( bytes_pending_ - pending_before );
 }
 
-/**
- * @brief find
- *
- * @param byte_index - the index of the byte to be found
- * @return int - the index of containing the byte_index of the packet
- */
-int Reassembler::find_the_contain_packet( uint64_t byte_index ) const
+void Reassembler::evict_farthest( uint64_t first_index, uint64_t len, uint64_t blocks )
 {
-
-  auto it = buffer_.find( byte_index );
-  if ( it != buffer_.end() ) {
-    return it->first;
+  uint64_t index = window_end();
+  uint64_t evicted = 0;
+  while ( ( evicted < len || blocks_held_ + blocks > block_limit() ) && index > first_index ) {
+    index -= stored_run_before( index, index - first_index, false );
+    /* Once enough bytes are gone, go on a block at a time: all that's stored of the farthest one */
+    const uint64_t wanted = evicted < len ? len - evicted : ( index - 1 ) % window_size_ % WindowBlock::kSize + 1;
+    const uint64_t run = min( stored_run_before( index, index - first_index ), wanted );
+    forget( index - run, run );
+    index -= run;
+    evicted += run;
   }
+  drops_.evicted += evicted;
+}
 
-  it = buffer_.lower_bound( byte_index );
-  if ( it == buffer_.begin() ) {
-    return -1;
-  }
-  --it;
-  const uint64_t& prev_index = it->first;
-  const ReassemblePacket& packet = it->second;
-  const uint64_t prev_max_index = calculate_max_index( prev_index, packet.data );
-  if ( prev_max_index >= byte_index ) {
-    return prev_index;
-  }
+uint64_t Reassembler::memory_usage() const
+{
+  return blocks_held_ * BufferPool::kBlockSizes.front() + blocks_.capacity() * sizeof( BlockPtr );
+}
 
-  return -1;
+void Reassembler::store( uint64_t first_index, string_view data )
+{
+  copy_backward( recent_.begin(), recent_.end() - 1, recent_.end() );
+  recent_.front() = first_index;
+
+  for_each_block_run( first_index, data.size(), [&]( uint64_t block, uint64_t slot, uint64_t len, uint64_t offset ) {
+    BlockPtr& b = blocks_[block];
+    if ( !b ) {
+      b = WindowBlock::make();
+      ++blocks_held_;
+    }
+    data.copy( b->bytes.data() + slot, len, offset );
+    for_each_word( b->present, slot, slot + len, [&]( uint64_t& word, uint64_t mask ) {
+      const uint64_t added = popcount( mask & ~word );
+      b->stored += added;
+      bytes_pending_ += added;
+      word |= mask;
+    } );
+    return true;
+  } );
 }
 
-void Reassembler::pushed_new_bytes( const string& data, bool is_last_substring )
+void Reassembler::forget( uint64_t first_index, uint64_t len )
 {
-  /* Buffer bytes */
-  const ReassemblePacket packet = ReassemblePacket { data, is_last_substring };
-  buffer_insertion( reassembled_first_index_, data, is_last_substring );
-  push_buffered_data( reassembled_first_index_ );
+  if ( bytes_pending_ == 0 ) {
+    return;
+  }
+  for_each_block_run( first_index, len, [&]( uint64_t block, uint64_t slot, uint64_t n, uint64_t ) {
+    BlockPtr& b = blocks_[block];
+    if ( b ) {
+      for_each_word( b->present, slot, slot + n, [&]( uint64_t& word, uint64_t mask ) {
+        const uint64_t removed = popcount( mask & word );
+        b->stored -= removed;
+        bytes_pending_ -= removed;
+        word &= ~mask;
+      } );
+      /* An empty block goes back to the pool */
+      if ( b->stored == 0 ) {
+        b.reset();
+        --blocks_held_;
+      }
+    }
+    return true;
+  } );
 }
 
-void Reassembler::buffer_in_assembler( uint64_t first_index, const string& data, bool is_last_substring )
+uint64_t Reassembler::stored_run( uint64_t index, uint64_t limit, bool present ) const
 {
-  buffer_insertion( first_index, data, is_last_substring );
+  /* A block that isn't held stores nothing */
+  uint64_t run = 0;
+  for_each_block_run( index, limit, [&]( uint64_t block, uint64_t slot, uint64_t len, uint64_t ) {
+    const BlockPtr& b = blocks_[block];
+    const uint64_t n = b ? bit_run( b->present, slot, len, present ) : present ? 0 : len;
+    run += n;
+    return n == len;
+  } );
+  return run;
 }
 
-void Reassembler::merge_overlap_from( const uint64_t first_index )
+uint64_t Reassembler::stored_run_before( uint64_t index, uint64_t limit, bool present ) const
 {
-  auto it = buffer_.lower_bound( first_index );
-  while ( it != buffer_.end() ) {
-    auto next_it = std::next( it );
-    if ( next_it == buffer_.end() ) {
-      return;
-    }
-    const uint64_t& index_1 = it->first;
-    const uint64_t& index_2 = next_it->first;
-    ReassemblePacket& packet_1 = it->second;
-    const ReassemblePacket& packet_2 = next_it->second;
-    const uint64_t max_index_1 = calculate_max_index( index_1, packet_1.data );
-    if ( max_index_1 >= index_2 ) {
-      uint64_t new_start_index = max_index_1 - index_2 + 1;
-      if ( new_start_index < packet_2.data.size() ) {
-        packet_1.data = packet_1.data + packet_2.data.substr( new_start_index );
-        packet_1.is_last_substring = packet_2.is_last_substring;
-      }
-      buffer_.erase( next_it );
-    } else {
-      return;
+  uint64_t run = 0;
+  while ( run < limit ) {
+    const uint64_t slot = ( index - run - 1 ) % window_size_;
+    const uint64_t end = slot % WindowBlock::kSize + 1;
+    const uint64_t len = min( limit - run, end );
+    const BlockPtr& b = blocks_[slot / WindowBlock::kSize];
+    const uint64_t n = b ? bit_run_before( b->present, end, len, present ) : present ? 0 : len;
+    run += n;
+    if ( n < len ) {
+      break;
     }
   }
+  return run;
 }
 
-void Reassembler::push_buffered_data( const uint64_t start_index )
+Reassembler::Range Reassembler::stored_range_around( uint64_t index ) const
 {
-  auto it = buffer_.find( start_index );
-  if ( it == buffer_.end() ) {
-    throw std::out_of_range( "Index not found in buffer" );
-  }
-  while ( it != buffer_.end() ) {
-    const uint64_t index = it->first;
-    const ReassemblePacket& packet = it->second;
-    output_.writer().push( packet.data );
-    reassembled_first_index_ += packet.data.size();
+  return { index - stored_run_before( index, index - reassembled_first_index_ ),
+           index + stored_run( index, window_end() - index ) };
+}
 
-    if ( packet.is_last_substring ) {
-      output_.writer().close();
+size_t Reassembler::stored_ranges( span<Range> ranges ) const
+{
+  size_t count = 0;
+  const auto add = [&]( const Range& range ) {
+    if ( find( ranges.begin(), ranges.begin() + count, range ) == ranges.begin() + count ) {
+      ranges[count++] = range;
     }
+  };
 
-    auto next_it = std::next( it );
-    const uint64_t next_index = next_it->first;
-    if ( next_it != buffer_.end() && ( index + packet.data.size() ) == next_index ) {
-      buffer_.erase( it );
-      it = next_it;
-    } else {
-      buffer_.erase( it );
-      it = buffer_.end();
+  /* First the ranges that recent stores went into, most recent first */
+  const uint64_t limit = window_end();
+  for ( const uint64_t index : recent_ ) {
+    if ( count == ranges.size() || bytes_pending_ == 0 ) {
+      return count;
+    }
+    if ( index >= reassembled_first_index_ && index < limit && stored_run( index, 1 ) == 1 ) {
+      add( stored_range_around( index ) );
     }
   }
-}
 
-// How many bytes are stored in the Reassembler itself?
-// This function is for testing only; don't add extra state to support it.
-uint64_t Reassembler::count_bytes_pending() const
-{
-  uint64_t count = 0;
-  for ( const auto& [index, packet] : buffer_ ) {
-    count += packet.data.size();
+  /* Then the rest in stream order, until every stored byte has been seen */
+  uint64_t index = reassembled_first_index_;
+  uint64_t seen = 0;
+  while ( count < ranges.size() && seen < bytes_pending_ ) {
+    index += stored_run( index, limit - index, false );
+    const uint64_t len = stored_run( index, limit - index );
+    add( { index, index + len } );
+    index += len;
+    seen += len;
   }
   return count;
 }
 
-/**
- * @return is trimed the end of data
- */
-bool Reassembler::trim_to_fit( uint64_t& first_index, std::string& data, bool& is_last_substring ) const
+void Reassembler::push_stored()
 {
-  uint64_t fit_max_index = reassembled_first_index_ + output_.writer().available_capacity() - 1;
-  uint64_t max_index = calculate_max_index( first_index, data );
-  bool is_suitable = reassembled_first_index_ <= first_index && max_index <= fit_max_index;
-  if ( !is_suitable ) {
-    uint64_t trimed_first_index = std::max<uint64_t>( first_index, reassembled_first_index_ );
-    uint64_t trimed_max_index = std::min<uint64_t>( max_index, fit_max_index );
-    data = data.substr( trimed_first_index - first_index, trimed_max_index - trimed_first_index + 1 );
-    first_index = trimed_first_index;
+  if ( bytes_pending_ > 0 ) {
+    /* The run of stored bytes starting at the next unassembled byte */
+    const uint64_t len = stored_run( reassembled_first_index_, writer().available_capacity() );
+
+    if ( len > 0 ) {
+      /* Copy straight from the window into the stream's storage (reserve() may hand out less than asked for,
+       * e.g. one pool block at a time for Chunked, so commit what was copied and go again) */
+      Writer& writer = output_.writer();
+      uint64_t pushed = 0;
+      while ( pushed < len ) {
+        uint64_t copied = 0;
+        for ( const span<char> free : writer.reserve( len - pushed ) ) {
+          const uint64_t index = reassembled_first_index_ + pushed + copied;
+          for_each_block_run( index, free.size(), [&]( uint64_t block, uint64_t slot, uint64_t n, uint64_t at ) {
+            copy_n( blocks_[block]->bytes.data() + slot, n, free.data() + at );
+            return true;
+          } );
+          copied += free.size();
+        }
+        writer.commit( copied );
+        if ( copied == 0 ) {
+          break;
+        }
+        pushed += copied;
+      }
+
+      forget( reassembled_first_index_, pushed );
+      reassembled_first_index_ += pushed;
+    }
   }
-  bool is_trimed_end = max_index > fit_max_index;
-  is_last_substring = is_last_substring && !is_trimed_end;
-  return max_index > fit_max_index;
-}
 
-void Reassembler::handle_match_first_index( const string& data, bool is_last_substring )
-{
-  buffer_insertion( reassembled_first_index_, data, is_last_substring );
-  push_buffered_data( reassembled_first_index_ );
-}
\ No newline at end of file
+  if ( end_index_ == reassembled_first_index_ ) {
+    output_.writer().close();
+  }
+}
@@ -1,20 +1,49 @@
 #pragma once
 
+#include "buffer_pool.hh"
 #include "byte_stream.hh"
+#include <array>
 #include <cstdint>
-#include <map>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
-struct ReassemblePacket
-{
-  std::string data;
-  bool is_last_substring;
-};
 class Reassembler
 {
 public:
+  // What to do with out-of-order bytes that would take the Reassembler past its memory limit
+  enum class DropPolicy : uint8_t
+  {
+    Newest,   // Refuse the arriving bytes (keeping as many of the first ones as fit)
+    Farthest, // First evict stored bytes that lie beyond the arriving ones, farthest first
+  };
+
+  // Bytes the Reassembler has discarded, by reason
+  struct DropCounters
+  {
+    uint64_t segments {};      // Insertions that lost any bytes
+    uint64_t beyond_window {}; // Bytes past the output's available capacity
+    uint64_t over_limit {};    // Arriving bytes refused because of the memory limit
+    uint64_t evicted {};       // Stored bytes evicted to make room for closer ones (DropPolicy::Farthest)
+  };
+
   // Construct Reassembler to write into given ByteStream.
-  explicit Reassembler( ByteStream&& output ) : output_( std::move( output ) ) {}
+  explicit Reassembler( ByteStream&& output )
+    : output_( std::move( output ) )
+    , window_size_( output_.writer().available_capacity() + output_.reader().bytes_buffered() )
+  {}
+
+  // Construct Reassembler that stores at most `memory_limit` out-of-order bytes, in at most `memory_limit` bytes
+  // of memory (but at least one window block), applying `policy` to the rest
+  Reassembler( ByteStream&& output, uint64_t memory_limit, DropPolicy policy )
+    : Reassembler( std::move( output ) )
+  {
+    memory_limit_ = memory_limit;
+    drop_policy_ = policy;
+  }
 
   /*
    * Insert a new substring to be reassembled into a ByteStream.
@@ -37,9 +66,22 @@ public:
    * The Reassembler should close the stream after writing the last byte.
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring );
-  // How many bytes are stored in the Reassembler itself?
-  // This function is for testing only; don't add extra state to support it.
-  uint64_t count_bytes_pending() const;
+  // How many bytes are stored in the Reassembler itself? (A running count, so this is O(1).)
+  uint64_t count_bytes_pending() const { return bytes_pending_; }
+
+  // Bytes held for out-of-order bytes: the window blocks that hold any of them, and the table of those blocks
+  uint64_t memory_usage() const;
+  const DropCounters& drops() const { return drops_; }
+
+  // A range [first, last) of stream indices
+  using Range = std::pair<uint64_t, uint64_t>;
+
+  /*
+   * Report the ranges of bytes the Reassembler has stored but not yet assembled (for SACK), filling
+   * at most `ranges.size()` of them. The ranges touched by the most recent insertions come first,
+   * most recent first, followed by the rest in stream order. Returns how many were filled; doesn't allocate.
+   */
+  size_t stored_ranges( std::span<Range> ranges ) const;
 
   // Access output stream reader
   Reader& reader() { return output_.reader(); }
@@ -49,24 +91,65 @@ public:
   const Writer& writer() const { return output_.writer(); }
 
 private:
+  // One pool block of the window: the bytes of kSize consecutive slots, and which of them are stored
+  struct WindowBlock
+  {
+    static constexpr uint64_t kSize = 1792; // as much as fits in a 2 KiB pool block along with the bitmap
+    std::array<char, kSize> bytes;
+    std::array<uint64_t, kSize / 64> present;
+    uint64_t stored; // Number of bits set in present
+
+    struct Release
+    {
+      void operator()( WindowBlock* block ) const;
+    };
+    static std::unique_ptr<WindowBlock, Release> make();
+  };
+  static_assert( sizeof( WindowBlock ) <= BufferPool::kBlockSizes.front() );
+  using BlockPtr = std::unique_ptr<WindowBlock, WindowBlock::Release>;
+
   ByteStream output_;
-  uint64_t reassembled_first_index_ { 0 };    // The index of the first byte that has not yet been reassembled
-  std::map<int, ReassemblePacket> buffer_ {}; // Buffer for reassembling packets
-
-  void handle_match_first_index( const std::string& data, bool is_last_substring );
-  void buffer_in_assembler( const uint64_t first_index,
-                            const std::string& data,
-                            bool is_last_substring ); // remain one byte for triggring push bytes into stream
-  void pushed_new_bytes( const std::string& data, bool is_last_substring );
-  bool is_capacity_exhausted() const { return output_.writer().available_capacity() == 0; }
-
-  bool trim_to_fit( uint64_t& first_index, std::string& data, bool& is_lasting_substring ) const;
-  bool is_inserted_out_of_range( const uint64_t index, const std::string& data ) const;
-  bool is_match_first_index( const uint64_t first_index ) const { return reassembled_first_index_ == first_index; }
-  bool is_already_buffered( const uint64_t first_index, const std::string& data ) const;
-  void merge_overlap_from( const uint64_t first_index );
-  void buffer_insertion( const uint64_t first_index, const std::string& data, bool is_last_substring );
-  void push_buffered_data( const uint64_t index );
-  int find_the_contain_packet( uint64_t first_index ) const;
-  uint64_t calculate_max_index( uint64_t index, const std::string& data ) const;
+  uint64_t reassembled_first_index_ { 0 }; // The index of the first byte that has not yet been reassembled
+  uint64_t window_size_;                   // The output's capacity: no byte at or past
+                                           // reassembled_first_index_ + window_size_ can ever be stored
+  std::vector<BlockPtr> blocks_ {};        // The window's slots (`index % window_size_`), kSize to a block
+                                           // (a block is held only while it stores bytes)
+  uint64_t blocks_held_ { 0 };             // Number of non-null entries of blocks_
+  uint64_t bytes_pending_ { 0 };           // Number of bytes stored in the window
+  std::optional<uint64_t> end_index_ {};   // The index just past the last byte of the stream, once known
+  std::array<uint64_t, 4> recent_ {};      // First indices of the most recent stores, most recent first
+                                           // (entries that no longer name a stored byte are skipped)
+  uint64_t memory_limit_ { UINT64_MAX };   // Most bytes that may be pending (or held in memory) at once
+  DropPolicy drop_policy_ { DropPolicy::Newest };
+  DropCounters drops_ {};
+
+  uint64_t window_end() const { return reassembled_first_index_ + writer().available_capacity(); }
+
+  // How many window blocks may be held at once
+  uint64_t block_limit() const;
+  // How many of the window blocks that stream bytes [first_index, first_index + len) fall in are not held
+  uint64_t missing_blocks( uint64_t first_index, uint64_t len ) const;
+  // Call `visit( block, slot, len, offset )` for each run of bytes [first_index, first_index + len) that lies
+  // within one window block (`slot` is where the run starts in the block, `offset` where in the bytes), until
+  // `visit` returns false
+  template<typename Visit>
+  void for_each_block_run( uint64_t first_index, uint64_t len, Visit&& visit ) const;
+  // Copy bytes that start at stream index `first_index` into the window and mark them present
+  void store( uint64_t first_index, std::string_view data );
+  // Store as much of `data` (at stream index `first_index`) as the memory limit allows, applying the drop policy
+  void store_within_limit( uint64_t first_index, std::string_view data );
+  // Drop any stored bytes in [first_index, first_index + len)
+  void forget( uint64_t first_index, uint64_t len );
+  // Drop stored bytes at or past stream index `first_index`, farthest first, until `len` of them are gone and
+  // `blocks` more window blocks could be held (or none are left)
+  void evict_farthest( uint64_t first_index, uint64_t len, uint64_t blocks );
+  // Push the run of present bytes at reassembled_first_index_ into the output, and close it if that's the end
+  void push_stored();
+  // How many consecutive bytes from stream index `index` on (at most `limit`) are stored (or, if not
+  // `present`, missing)
+  uint64_t stored_run( uint64_t index, uint64_t limit, bool present = true ) const;
+  // How many consecutive bytes just before stream index `index` (at most `limit`) are stored (or missing)
+  uint64_t stored_run_before( uint64_t index, uint64_t limit, bool present = true ) const;
+  // The range of stored bytes around the stored byte at stream index `index`
+  Range stored_range_around( uint64_t index ) const;
 };
@@ -0,0 +1,186 @@
+#include "spsc_byte_stream.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Readiness: the writer notifies readable_ only if the ring was empty before its push, and the reader notifies
+ * writable_ only if the ring was full before its pop. The counters are stored and then the other side's counter
+ * loaded with sequentially-consistent ordering, so when one side finds the ring empty (full) and goes to sleep,
+ * either it saw the other side's latest update or the other side sees its update and notifies.
+ */
+
+SPSCByteStream::SPSCByteStream( uint64_t capacity ) : capacity_( capacity ), buffer_( capacity, '\0' )
+{
+  if ( capacity_ == 0 ) {
+    throw runtime_error( "SPSCByteStream capacity must be positive" );
+  }
+  writable_.notify();
+}
+
+void SPSCByteStream::set_error()
+{
+  error_.store( true );
+  readable_.notify();
+  writable_.notify();
+}
+
+uint64_t SPSCWriter::push( string_view data )
+{
+  uint64_t pushed = 0;
+  for ( const auto region : reserve( data.size() ) ) {
+    data.copy( region.data(), region.size(), pushed );
+    pushed += region.size();
+  }
+  commit( pushed );
+  return pushed;
+}
+
+vector<span<char>> SPSCWriter::reserve( uint64_t len )
+{
+  const uint64_t written = write_byte_num_.load( memory_order_relaxed );
+  if ( written - cached_read_byte_num_ + len > capacity_ ) {
+    cached_read_byte_num_ = read_byte_num_.load();
+  }
+  reserved_ = min( len, capacity_ - ( written - cached_read_byte_num_ ) );
+
+  vector<span<char>> spans;
+  if ( reserved_ == 0 ) {
+    return spans;
+  }
+  const uint64_t tail = written % capacity_;
+  const uint64_t first_part = min( reserved_, capacity_ - tail );
+  spans.emplace_back( buffer_.data() + tail, first_part );
+  if ( first_part < reserved_ ) {
+    spans.emplace_back( buffer_.data(), reserved_ - first_part );
+  }
+  return spans;
+}
+
+void SPSCWriter::commit( uint64_t len )
+{
+  if ( len > reserved_ ) {
+    throw runtime_error( "SPSCWriter::commit() of more bytes than were reserved" );
+  }
+  reserved_ = 0;
+  publish( len );
+}
+
+void SPSCWriter::publish( uint64_t len )
+{
+  if ( len == 0 ) {
+    return;
+  }
+  const uint64_t before = write_byte_num_.load( memory_order_relaxed );
+  write_byte_num_.store( before + len );
+  /* The reader may be waiting only if the ring was empty before these bytes */
+  if ( read_byte_num_.load() == before ) {
+    readable_.notify();
+  }
+}
+
+void SPSCWriter::close()
+{
+  closed_.store( true );
+  readable_.notify();
+}
+
+bool SPSCWriter::is_closed() const
+{
+  return closed_.load( memory_order_acquire );
+}
+
+uint64_t SPSCWriter::available_capacity() const
+{
+  return capacity_ - ( write_byte_num_.load( memory_order_relaxed ) - read_byte_num_.load() );
+}
+
+uint64_t SPSCWriter::bytes_pushed() const
+{
+  return write_byte_num_.load( memory_order_relaxed );
+}
+
+/* The below code is reader functions */
+
+string_view SPSCReader::peek() const
+{
+  const uint64_t head = read_byte_num_.load( memory_order_relaxed ) % capacity_;
+  return { buffer_.data() + head, min( bytes_buffered(), capacity_ - head ) };
+}
+
+vector<string_view> SPSCReader::peek_all() const
+{
+  vector<string_view> regions;
+  const uint64_t buffered = bytes_buffered();
+  if ( buffered == 0 ) {
+    return regions;
+  }
+  const uint64_t head = read_byte_num_.load( memory_order_relaxed ) % capacity_;
+  const uint64_t first_part = min( buffered, capacity_ - head );
+  regions.emplace_back( buffer_.data() + head, first_part );
+  if ( first_part < buffered ) {
+    regions.emplace_back( buffer_.data(), buffered - first_part );
+  }
+  return regions;
+}
+
+void SPSCReader::pop( uint64_t len )
+{
+  len = min( len, bytes_buffered() );
+  if ( len == 0 ) {
+    return;
+  }
+  const uint64_t before = read_byte_num_.load( memory_order_relaxed );
+  read_byte_num_.store( before + len );
+  /* The writer may be waiting only if the ring was full before this pop (it may have pushed again since) */
+  if ( write_byte_num_.load() - before >= capacity_ ) {
+    writable_.notify();
+  }
+}
+
+bool SPSCReader::is_finished() const
+{
+  return closed_.load( memory_order_acquire ) and bytes_buffered() == 0;
+}
+
+uint64_t SPSCReader::bytes_buffered() const
+{
+  return write_byte_num_.load() - read_byte_num_.load( memory_order_relaxed );
+}
+
+uint64_t SPSCReader::bytes_popped() const
+{
+  return read_byte_num_.load( memory_order_relaxed );
+}
+
+SPSCReader& SPSCByteStream::reader()
+{
+  static_assert( sizeof( SPSCReader ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCReader." );
+
+  return static_cast<SPSCReader&>( *this ); // NOLINT(*-downcast)
+}
+
+const SPSCReader& SPSCByteStream::reader() const
+{
+  return static_cast<const SPSCReader&>( *this ); // NOLINT(*-downcast)
+}
+
+SPSCWriter& SPSCByteStream::writer()
+{
+  static_assert( sizeof( SPSCWriter ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCWriter." );
+
+  return static_cast<SPSCWriter&>( *this ); // NOLINT(*-downcast)
+}
+
+const SPSCWriter& SPSCByteStream::writer() const
+{
+  return static_cast<const SPSCWriter&>( *this ); // NOLINT(*-downcast)
+}
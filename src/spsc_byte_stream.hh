@@ -0,0 +1,104 @@
+#pragma once
+
+#include "eventfd.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SPSCReader;
+class SPSCWriter;
+
+/*
+ * A ByteStream that one thread can write while another thread reads, without locks.
+ *
+ * The buffered bytes live in a fixed-size ring. The writer only ever stores the count of bytes
+ * pushed, the reader only ever stores the count of bytes popped, and each counter sits on its own
+ * cache line with the rest of its owner's state, so the two threads don't write to a shared line.
+ *
+ * Each side has an eventfd that an EventLoop can poll (Direction::In), edge-triggered like EPOLLET:
+ *   - readable_fd() is notified when the stream goes from empty to non-empty, is closed, or has an error;
+ *   - writable_fd() is notified when the stream goes from full to non-full, or has an error.
+ * When woken, a side should clear() its eventfd first and then keep reading (writing) until the stream is
+ * empty (full) or it has nothing more to do; otherwise it may not be woken again.
+ */
+class SPSCByteStream
+{
+public:
+  explicit SPSCByteStream( uint64_t capacity );
+
+  // Access the Reader (for the consumer thread) and Writer (for the producer thread) interfaces
+  SPSCReader& reader();
+  const SPSCReader& reader() const;
+  SPSCWriter& writer();
+  const SPSCWriter& writer() const;
+
+  void set_error();      // Signal that the stream suffered an error.
+  bool has_error() const // Has the stream had an error?
+  {
+    return error_.load( std::memory_order_acquire );
+  }
+
+  EventFD& readable_fd() { return readable_; } // Poll for the reader
+  EventFD& writable_fd() { return writable_; } // Poll for the writer
+
+  // Shared between threads by reference: no copies or moves
+  SPSCByteStream( const SPSCByteStream& other ) = delete;
+  SPSCByteStream& operator=( const SPSCByteStream& other ) = delete;
+  SPSCByteStream( SPSCByteStream&& other ) = delete;
+  SPSCByteStream& operator=( SPSCByteStream&& other ) = delete;
+  ~SPSCByteStream() = default;
+
+protected:
+  static constexpr size_t kCacheLineSize = 64;
+
+  // Please add any additional state to the SPSCByteStream here, and not to the Writer and Reader interfaces.
+  uint64_t capacity_;
+  std::string buffer_;
+  EventFD readable_ {};
+  EventFD writable_ {};
+
+  // Owned by the writer thread
+  alignas( kCacheLineSize ) std::atomic<uint64_t> write_byte_num_ {};
+  uint64_t cached_read_byte_num_ {}; // the writer's last view of read_byte_num_ (only ever behind)
+  uint64_t reserved_ {};             // bytes handed out by SPSCWriter::reserve() but not yet committed
+
+  // Owned by the reader thread
+  alignas( kCacheLineSize ) std::atomic<uint64_t> read_byte_num_ {};
+
+  alignas( kCacheLineSize ) std::atomic<bool> closed_ {};
+  std::atomic<bool> error_ {};
+};
+
+class SPSCWriter : public SPSCByteStream
+{
+public:
+  uint64_t push( std::string_view data ); // Push as much data as available capacity allows; returns bytes pushed
+  void close();                           // Signal that the stream has reached its ending.
+
+  // Writable spans inside the ring for up to `len` bytes; valid until the next push(), reserve() or commit()
+  std::vector<std::span<char>> reserve( uint64_t len );
+  void commit( uint64_t len ); // Publish the first `len` bytes written into the spans from reserve()
+
+  bool is_closed() const;              // Has the stream been closed?
+  uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
+  uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+
+private:
+  void publish( uint64_t len );
+};
+
+class SPSCReader : public SPSCByteStream
+{
+public:
+  std::string_view peek() const;                  // Peek at the next bytes in the buffer (up to the wrap point)
+  std::vector<std::string_view> peek_all() const; // Peek at every buffered byte, one view per contiguous region
+  void pop( uint64_t len );                       // Remove `len` bytes from the buffer
+
+  bool is_finished() const;        // Is the stream finished (closed and fully popped)?
+  uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
+  uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+};
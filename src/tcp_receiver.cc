@@ -1,9 +1,13 @@
 #include "tcp_receiver.hh"
 #include "debug.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <utility>
 
 using namespace std;
 
@@ -25,19 +29,28 @@ void TCPReceiver::receive( TCPSenderMessage message )
   }
 }
 
-void TCPReceiver::closed_handler( const TCPSenderMessage& msg )
+void TCPReceiver::closed_handler( TCPSenderMessage& msg )
 {
   if ( msg.SYN ) {
     this->isn_ = msg.seqno;
     this->rcv_absolute_ack_seq_ = 0;
+    this->sack_permitted_ = msg.SACK_permitted;
+    this->window_shift_ = window_scale_offered_.has_value() && msg.window_scale.has_value()
+                            ? std::min( window_scale_offered_.value(), TCPConfig::MAX_WINDOW_SCALE )
+                            : 0;
+    this->timestamps_ = timestamps_offered_ && msg.timestamp.has_value();
+    this->ts_recent_ = msg.timestamp.value_or( 0 );
     kReceiverState_ = ReceiverState::ESTABLISHED;
     byte_push( msg );
     rcv_absolute_ack_seq_ += ( msg.SYN + msg.FIN );
   }
 }
 
-void TCPReceiver::established_handler( const TCPSenderMessage& msg )
+void TCPReceiver::established_handler( TCPSenderMessage& msg )
 {
+  if ( paws_reject( msg ) ) {
+    return;
+  }
   byte_push( msg );
   if ( reassembler_.writer().is_closed() ) {
     rcv_absolute_ack_seq_ += ( reassembler_.writer().is_closed() );
@@ -45,23 +58,56 @@ void TCPReceiver::established_handler( const TCPSenderMessage& msg )
   }
 }
 
-void TCPReceiver::byte_push( const TCPSenderMessage& msg )
+/**
+ * @brief RFC 7323, section 5.3: once timestamps are in use, a segment without one, or with a TSval older than
+ * TS.Recent, is dropped (its sequence numbers may be from an earlier wrap of the sequence space). Otherwise a
+ * segment that starts at or before the ackno updates TS.Recent, so the echo times the segment that the ack
+ * answers and not one that arrived out of order.
+ */
+bool TCPReceiver::paws_reject( const TCPSenderMessage& msg )
+{
+  if ( !timestamps_ ) {
+    return false;
+  }
+  if ( !msg.timestamp.has_value() || static_cast<int32_t>( msg.timestamp.value() - ts_recent_ ) < 0 ) {
+    return true;
+  }
+  if ( msg.seqno.unwrap( isn_, rcv_absolute_ack_seq_ ) <= rcv_absolute_ack_seq_ ) {
+    ts_recent_ = msg.timestamp.value();
+  }
+  return false;
+}
+
+void TCPReceiver::byte_push( TCPSenderMessage& msg )
 {
   uint64_t stream_seq = msg.seqno.unwrap( isn_, rcv_absolute_ack_seq_ ) - ( !msg.SYN );
   uint64_t old_pushed_bytes = reassembler_.writer().bytes_pushed();
-  reassembler_.insert( stream_seq, msg.payload, msg.FIN );
+  reassembler_.insert( stream_seq, move( msg.payload ), msg.FIN );
   uint64_t new_pushed_bytes = reassembler_.writer().bytes_pushed();
   rcv_absolute_ack_seq_ += ( new_pushed_bytes - old_pushed_bytes );
 }
 
-TCPReceiverMessage TCPReceiver::send() const
+TCPReceiverMessage TCPReceiver::send( bool with_syn ) const
 {
   TCPReceiverMessage receive_msg_;
   if ( rcv_absolute_ack_seq_ != 0 ) {
     receive_msg_.ackno = isn_.wrap( rcv_absolute_ack_seq_, isn_ );
   }
-  uint64_t capacity = reassembler_.writer().available_capacity();
+  if ( receive_msg_.ackno.has_value() && sack_permitted_ ) {
+    /* Stream index i is absolute sequence number i + 1 (after the SYN) */
+    array<Reassembler::Range, TCPReceiverMessage::MAX_SACK_BLOCKS> ranges;
+    const size_t count = reassembler_.stored_ranges( ranges );
+    for ( size_t i = 0; i < count; ++i ) {
+      receive_msg_.sack_blocks[i]
+        = { Wrap32::wrap( ranges[i].first + 1, isn_ ), Wrap32::wrap( ranges[i].second + 1, isn_ ) };
+    }
+    receive_msg_.sack_block_count = static_cast<uint8_t>( count );
+  }
+  uint64_t capacity = reassembler_.writer().available_capacity() >> ( with_syn ? 0 : window_shift_ );
   receive_msg_.window_size = capacity >= UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>( capacity );
+  if ( receive_msg_.ackno.has_value() && timestamps_ ) {
+    receive_msg_.timestamp_echo = ts_recent_;
+  }
   receive_msg_.RST = reassembler_.writer().has_error();
   return { receive_msg_ };
 }
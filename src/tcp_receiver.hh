@@ -5,6 +5,7 @@
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
 #include <cstdint>
+#include <optional>
 
 class TCPReceiver
 {
@@ -14,6 +15,17 @@ public:
     : reassembler_( std::move( reassembler ) ), isn_( 0 ), rcv_absolute_ack_seq_( 0 ), kReceiverState_( ReceiverState::CLOSED )
   {}
 
+  // Construct with given Reassembler, advertising windows scaled by `window_scale` (RFC 7323) if the peer's SYN
+  // also offers window scaling (our own SYN, from the TCPSender, offers the same shift count). With `timestamps`
+  // (which our SYN offers too), a peer whose SYN carries the timestamps option gets its TSvals echoed, and its
+  // segments with an older TSval than the last in-order one are dropped (PAWS)
+  TCPReceiver( Reassembler&& reassembler, std::optional<uint8_t> window_scale, bool timestamps = false )
+    : TCPReceiver( std::move( reassembler ) )
+  {
+    window_scale_offered_ = window_scale;
+    timestamps_offered_ = timestamps;
+  }
+
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into the Reassembler
    * at the correct stream index.
@@ -21,16 +33,23 @@ public:
   void receive( TCPSenderMessage message );
 
   // The TCPReceiver sends TCPReceiverMessages to the peer's TCPSender.
-  TCPReceiverMessage send() const;
+  // (`with_syn`: the segment also carries our SYN, whose window is never scaled)
+  TCPReceiverMessage send( bool with_syn = false ) const;
+
+  // The shift count applied to the advertised window (0 unless both SYNs offered window scaling)
+  uint8_t window_shift() const { return window_shift_; }
+
+  // Whether both SYNs carried the timestamps option
+  bool timestamps() const { return timestamps_; }
 
   // Access the output
   const Reassembler& reassembler() const { return reassembler_; }
   Reader& reader() { return reassembler_.reader(); }
   const Reader& reader() const { return reassembler_.reader(); }
   const Writer& writer() const { return reassembler_.writer(); }
-  void closed_handler( const TCPSenderMessage& msg );
-  void established_handler( const TCPSenderMessage& msg );
-  void byte_push( const TCPSenderMessage& msg );
+  void closed_handler( TCPSenderMessage& msg );
+  void established_handler( TCPSenderMessage& msg );
+  void byte_push( TCPSenderMessage& msg ); // moves the payload into the Reassembler
 
 private:
   Reassembler reassembler_;
@@ -44,6 +63,23 @@ private:
    * 下一个应该ack的绝对序列号
    */
   uint64_t rcv_absolute_ack_seq_;
+  /**
+   * @brief the peer's SYN carried SACK-permitted, so acks may carry SACK blocks (RFC 2018)
+   */
+  bool sack_permitted_ {};
+  /**
+   * @brief the shift count offered on our SYN, and the one in effect once the peer's SYN offered one too
+   */
+  std::optional<uint8_t> window_scale_offered_ {};
+  uint8_t window_shift_ {};
+  /**
+   * @brief whether our SYN offers timestamps, whether the peer's did too, and TS.Recent: the TSval to echo,
+   * from the latest segment that began at or before the ackno (RFC 7323, section 4.3)
+   */
+  bool timestamps_offered_ {};
+  bool timestamps_ {};
+  uint32_t ts_recent_ {};
+  bool paws_reject( const TCPSenderMessage& msg );
   enum class ReceiverState
   {
     CLOSED,
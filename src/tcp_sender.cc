@@ -11,9 +11,31 @@
 #include <string>
 #include <string_view>
 #include <sys/types.h>
+#include <utility>
 
 using namespace std;
 
+TCPSender::TCPSender( ByteStream&& input, const TCPConfig& config )
+  : TCPSender( std::move( input ), config.isn, config.rt_timeout )
+{
+  if ( config.adaptive_rto ) {
+    rtt_.emplace( config.rt_timeout, config.rt_timeout_min, config.rt_timeout_max );
+    timer_.max_RTO_ms_ = config.rt_timeout_max;
+  }
+  mss_ = config.mss;
+  max_payload_ = std::max( config.mss, TCPConfig::MIN_MSS );
+  congestion_algorithm_ = config.congestion_control;
+  congestion_control_ = CongestionControl::make( congestion_algorithm_, max_payload_ );
+  fast_retransmit_ = config.fast_retransmit;
+  sack_ = config.sack;
+  if ( config.window_scaling ) {
+    window_scale_ = config.window_scale();
+  }
+  timestamps_ = config.timestamps;
+  high_sacked_ = config.isn;
+  update_congestion_window();
+}
+
 // This function is for testing only; don't add extra state to support it.
 uint64_t TCPSender::sequence_numbers_in_flight() const
 {
@@ -23,39 +45,48 @@ uint64_t TCPSender::sequence_numbers_in_flight() const
 // This function is for testing only; don't add extra state to support it.
 uint64_t TCPSender::consecutive_retransmissions() const
 {
-  uint8_t count = 0;
-  uint64_t RTO_ms = timer_.RTO_ms_;
-  while ( initial_RTO_ms_ != RTO_ms ) {
-    RTO_ms /= 2;
-    count++;
-  }
-  return count;
+  return timer_.retransmissions_;
+}
+
+std::optional<uint64_t> TCPSender::smoothed_RTT_ms() const
+{
+  return rtt_.has_value() ? rtt_->smoothed_RTT_ms() : std::nullopt;
 }
 
 bool TCPSender::segment_has_next_payload()
 {
-  TCPSenderMessage msg = segment_get_just_contain_payload();
-  return pending_processed2segment_bytes() != msg.payload.size()
-         && window_.available_send_space() != msg.payload.size();
+  const uint64_t payload_size = next_payload_size();
+  return pending_processed2segment_bytes() != payload_size && window_.available_send_space() != payload_size;
 }
 
-void TCPSender::segment_transmit( const TCPSenderMessage& msg, const TransmitFunction& transmit )
+void TCPSender::segment_transmit( TCPSenderMessage& msg, const TransmitFunction& transmit )
 {
+  if ( congestion_control_ ) {
+    congestion_control_->on_send( msg.sequence_length(), window_.transmitting_bytes_count(), now_ms_ );
+  }
   transmit( msg );
   window_.next_seq_ = window_.next_seq_ + static_cast<uint32_t>( msg.sequence_length() );
   segment_control_create( msg );
 }
 
-TCPSenderMessage TCPSender::segment_get_just_contain_payload() const
+Reader::ChunkLoan TCPSender::segment_get_just_contain_payload( TCPSenderMessage& msg )
 {
-  TCPSenderMessage msg = TCPSenderMessage();
   msg.seqno = window_.next_seq_;
-  msg.payload = this->get_next_payload();
-  return msg;
+  Reader::ChunkLoan loan = this->get_next_payload( msg.payload );
+  stamp( msg );
+  return loan;
 }
 
 void TCPSender::push( const TransmitFunction& transmit )
 {
+  if ( retransmit_pending_ ) {
+    retransmit_pending_ = false;
+    retransmit_first( transmit );
+  }
+  if ( window_.sack_recovery_ ) {
+    retransmit_holes( transmit );
+  }
+
   switch ( kSenderState_ ) {
     case SenderState::CLOSED:
       push_closed_handler( transmit );
@@ -78,8 +109,13 @@ void TCPSender::push( const TransmitFunction& transmit )
 void TCPSender::push_closed_handler( const TransmitFunction& transmit )
 {
   window_.rcv_window_ -= 1;
-  TCPSenderMessage msg = segment_get_just_contain_payload();
+  TCPSenderMessage msg;
+  const Reader::ChunkLoan loan = segment_get_just_contain_payload( msg );
   msg.SYN = true;
+  // RFC 2018 and RFC 7323: a SYN-ACK carries these options only in reply to a SYN that did
+  msg.SACK_permitted = sack_ && peer_sack_.value_or( true );
+  msg.window_scale = peer_window_scaling_.value_or( true ) ? window_scale_ : std::nullopt;
+  msg.max_segment_size = mss_;
   if ( segment_after_this_window_has_space( msg ) ) {
     msg.FIN = writer().is_closed();
   }
@@ -101,8 +137,9 @@ void TCPSender::push_established_handler( const TransmitFunction& transmit )
     return;
   }
 
-  while ( true ) {
-    TCPSenderMessage msg = segment_get_just_contain_payload();
+  while ( !window_.congestion_limited_runt( pending_processed2segment_bytes(), max_payload_ ) ) {
+    TCPSenderMessage msg;
+    const Reader::ChunkLoan loan = segment_get_just_contain_payload( msg );
     if ( segment_has_next_payload() ) {
       segment_transmit( msg, transmit );
       timer_.start_if_stopped();
@@ -129,13 +166,22 @@ void TCPSender::push_established_zero_window_handler( const TransmitFunction& tr
   }
 
   window_.rcv_window_ += 1;
-  TCPSenderMessage msg = segment_get_just_contain_payload();
+  TCPSenderMessage msg;
+  const Reader::ChunkLoan loan = segment_get_just_contain_payload( msg );
   msg.FIN = msg.payload.empty() ? writer().is_closed() : false;
   segment_transmit( msg, transmit );
   timer_.start_if_stopped();
   window_.rcv_window_ -= 1;
 }
 
+void TCPSender::set_peer_window_scale( std::optional<uint8_t> window_scale )
+{
+  peer_window_scaling_ = window_scale.has_value();
+  peer_window_shift_ = window_scale_.has_value() && window_scale.has_value()
+                         ? std::min( window_scale.value(), TCPConfig::MAX_WINDOW_SCALE )
+                         : 0;
+}
+
 TCPSenderMessage TCPSender::make_empty_message() const
 {
   TCPSenderMessage msg = TCPSenderMessage();
@@ -143,24 +189,81 @@ TCPSenderMessage TCPSender::make_empty_message() const
   msg.FIN = false;
   msg.RST = reader().has_error();
   msg.seqno = window_.next_seq_;
+  stamp( msg );
   return msg;
 }
 
-void TCPSender::receive( const TCPReceiverMessage& msg )
+void TCPSender::set_peer_sack_permitted( bool sack_permitted )
+{
+  peer_sack_ = sack_permitted;
+}
+
+void TCPSender::set_peer_timestamps( bool timestamps )
+{
+  peer_timestamps_ = timestamps;
+  update_max_payload();
+}
+
+void TCPSender::set_peer_mss( std::optional<uint16_t> mss )
+{
+  peer_mss_ = mss.value_or( TCPConfig::DEFAULT_PEER_MSS );
+  update_max_payload();
+}
+
+// The MSS counts only the payload, so options that every segment carries come out of it (RFC 6691). An MSS
+// below MIN_MSS (say, 0 from a hostile SYN) is raised to it, which leaves room for a payload after the options.
+void TCPSender::update_max_payload()
+{
+  const uint16_t mss = std::max(
+    std::min( mss_.value_or( TCPConfig::MAX_PAYLOAD_SIZE ), peer_mss_.value_or( UINT16_MAX ) ), TCPConfig::MIN_MSS );
+  const uint16_t options = timestamps_ && peer_timestamps_.value_or( false ) ? TIMESTAMPS_OPTION_LENGTH : 0;
+  static_assert( TCPConfig::MIN_MSS > TIMESTAMPS_OPTION_LENGTH );
+  const uint16_t max_payload = mss - options;
+  if ( max_payload == max_payload_ ) {
+    return;
+  }
+  max_payload_ = max_payload;
+  // this happens during the handshake, before any data has gone out: the congestion controller just starts
+  // over with the new segment size (and the initial window that goes with it)
+  if ( congestion_control_ ) {
+    congestion_control_ = CongestionControl::make( congestion_algorithm_, max_payload_ );
+    update_congestion_window();
+  }
+}
+
+// TSval is the sender's clock, which the owner advances through tick(): a millisecond per unit (RFC 7323 allows
+// anything from 1 ms to 1 s), wrapping at 32 bits like the sequence numbers
+void TCPSender::stamp( TCPSenderMessage& msg ) const
+{
+  if ( timestamps_in_use() ) {
+    msg.timestamp = static_cast<uint32_t>( now_ms_ );
+  }
+}
+
+void TCPSender::receive( const TCPReceiverMessage& msg, bool pure_ack )
 {
-  window_.rcv_window_ = msg.window_size;
+  const uint32_t previous_window = window_.rcv_window_;
+  window_.rcv_window_ = uint32_t { msg.window_size } << peer_window_shift_;
 
   if ( msg.ackno.has_value() ) {
+    if ( msg.ackno.value() >= window_.base_ && msg.ackno.value() <= window_.next_seq_ ) {
+      update_scoreboard( msg );
+    }
+
+    // RFC 5681: the same ackno again, on a segment with no data and no change to the window
+    if ( msg.ackno.value() == window_.base_ && pure_ack && window_.rcv_window_ == previous_window && !msg.RST ) {
+      receive_duplicate_ack();
+    }
+
     /**
      * @brief ignore old ack
      *
      */
-    if ( msg.ackno.value().raw_value() <= window_.base_.raw_value() ) {
+    if ( msg.ackno.value() <= window_.base_ ) {
       return;
     }
 
-    uint32_t max_ackno = window_.next_seq_.raw_value();
-    if ( msg.ackno.value().raw_value() > max_ackno ) {
+    if ( msg.ackno.value() > window_.next_seq_ ) {
       return;
     }
   }
@@ -190,7 +293,7 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
 
 void TCPSender::receive_syn_sent_handler( const TCPReceiverMessage& msg )
 {
-  if ( msg.ackno.value().raw_value() >= window_.base_.raw_value() + 1 ) {
+  if ( msg.ackno.value() > window_.base_ ) {
     kSenderState_ = SenderState::ESTABLISHED;
     receive_established_handler( msg );
   }
@@ -223,13 +326,33 @@ void TCPSender::receive_established_zero_window_handler( const TCPReceiverMessag
 
 void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
 {
-  if ( retransmit_msgs_.empty() ) {
+  now_ms_ += ms_since_last_tick;
+  if ( retransmit_queue_.empty() ) {
     timer_.stop();
   } else {
     timer_.tick( ms_since_last_tick );
     if ( timer_.timeout() ) {
-      TCPSenderMessage msg = get_timeout_msg();
-      transmit( msg );
+      // only the first of a run of timeouts is a new loss (RFC 5681: later ones keep ssthresh)
+      if ( congestion_control_ && timer_.retransmissions_ == 1
+           && kSenderState_ != SenderState::ESTABLISHED_ZERO_WINDOW ) {
+        congestion_control_->on_timeout( window_.transmitting_bytes_count(), now_ms_ );
+        update_congestion_window();
+      }
+      if ( fast_retransmit_ && kSenderState_ != SenderState::ESTABLISHED_ZERO_WINDOW ) {
+        recovery_ = Recovery::TIMEOUT;
+        recover_ = window_.next_seq_;
+        duplicate_acks_ = 0;
+        // with a scoreboard, everything not SACKed is presumed lost, and resent as the window opens again
+        clear_lost();
+        window_.sack_recovery_ = window_.left_network_ > 0;
+        if ( window_.sack_recovery_ ) {
+          reset_recovery_cursors();
+          for ( size_t i = 0; i < retransmit_queue_.size(); ++i ) {
+            mark_lost( retransmit_queue_[i] );
+          }
+        }
+      }
+      retransmit( retransmit_queue_.front(), transmit );
       if ( kSenderState_ == SenderState::ESTABLISHED_ZERO_WINDOW ) {
         timer_.reset();
       }
@@ -238,61 +361,405 @@ void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& trans
   }
 }
 
-uint16_t TCPSender::pending_processed2segment_bytes() const
+uint64_t TCPSender::pending_processed2segment_bytes() const
 {
-  uint64_t pending_count = reader().bytes_buffered() - window_.transmitting_bytes_count();
-  uint16_t result = std::min( pending_count, static_cast<uint64_t>( UINT16_MAX ) );
-  return result;
+  return reader().bytes_buffered() - window_.transmitting_bytes_count();
 }
 
 void TCPSender::segment_control_create( const TCPSenderMessage& msg )
 {
-  retransmit_msgs_.push_back( msg );
+  // the payload was read `distance( base_, seqno )` bytes into the outbound stream's buffer
+  retransmit_queue_.push_back( { .seqno = msg.seqno,
+                                 .stream_index
+                                 = reader().bytes_popped() + Wrap32::distance( window_.base_, msg.seqno ),
+                                 .length = static_cast<uint16_t>( msg.payload.size() ),
+                                 .SYN = msg.SYN,
+                                 .FIN = msg.FIN,
+                                 .sent_ms = now_ms_,
+                                 .retransmitted = false } );
 }
 
 void TCPSender::segment_update_state_for_ack( const TCPReceiverMessage& msg )
 {
+  const uint64_t bytes_acked = Wrap32::distance( window_.base_, msg.ackno.value() );
+  const uint64_t bytes_in_flight = window_.transmitting_bytes_count();
   window_.base_ = msg.ackno.value();
   segment_control_remove_for_ack( msg );
+  duplicate_acks_ = 0;
+  high_sacked_ = std::max( high_sacked_, window_.base_ );
+
+  if ( recovery_ != Recovery::NONE ) {
+    if ( msg.ackno.value() < recover_ ) {
+      // partial ack: the segment it stops at was lost as well, so resend it now rather than after an RTO
+      if ( !window_.sack_recovery_ ) {
+        retransmit_pending_ = true;
+      } else if ( !retransmit_queue_.front().retransmitted ) {
+        mark_lost( retransmit_queue_.front() );
+      }
+      if ( recovery_ == Recovery::FAST ) {
+        // (with SACK, the pipe already accounts for what left the network: cwnd stays at ssthresh)
+        if ( congestion_control_ && !window_.sack_recovery_ ) {
+          congestion_control_->on_partial_ack( bytes_acked );
+          update_congestion_window();
+        }
+        return;
+      }
+    } else {
+      // everything outstanding when recovery started is acked: recovery is over
+      clear_lost();
+      window_.sack_recovery_ = false;
+      if ( std::exchange( recovery_, Recovery::NONE ) == Recovery::FAST ) {
+        if ( congestion_control_ ) {
+          congestion_control_->on_recovery_exit( window_.transmitting_bytes_count() );
+          update_congestion_window();
+        }
+        return;
+      }
+    }
+  }
+
+  if ( congestion_control_ ) {
+    congestion_control_->on_ack( bytes_acked, bytes_in_flight, smoothed_RTT_ms(), now_ms_ );
+    update_congestion_window();
+  }
+}
+
+void TCPSender::receive_duplicate_ack()
+{
+  if ( !fast_retransmit_ || window_.transmitting_bytes_count() == 0
+       || ( kSenderState_ != SenderState::ESTABLISHED && kSenderState_ != SenderState::FIN_SENT ) ) {
+    return;
+  }
+  duplicate_acks_++;
+  if ( recovery_ == Recovery::FAST ) {
+    // each further duplicate means another segment has left the network (with SACK, the pipe counts it)
+    if ( congestion_control_ && !window_.sack_recovery_ ) {
+      congestion_control_->on_duplicate_ack();
+      update_congestion_window();
+    }
+    return;
+  }
+  if ( recovery_ == Recovery::NONE && duplicate_acks_ == DUPLICATE_ACK_THRESHOLD ) {
+    recovery_ = Recovery::FAST;
+    recover_ = window_.next_seq_;
+    retransmit_pending_ = true;
+    // a peer that SACKs says which segments it holds: recover by the scoreboard rather than by NewReno
+    window_.sack_recovery_ = window_.left_network_ > 0;
+    if ( window_.sack_recovery_ ) {
+      reset_recovery_cursors();
+      mark_holes_lost();
+    }
+    if ( congestion_control_ ) {
+      if ( window_.sack_recovery_ ) {
+        congestion_control_->on_loss( window_.transmitting_bytes_count(), now_ms_ );
+      } else {
+        congestion_control_->on_fast_retransmit( window_.transmitting_bytes_count(), now_ms_ );
+      }
+      update_congestion_window();
+    }
+  }
+}
+
+/**
+ * @brief mark the outstanding segments that the SACK blocks cover, which leave the pipe. Blocks that aren't
+ * within what's in flight are ignored. Ranges the previous ack's blocks already covered are skipped, so a
+ * growing block costs only its new segments however large the window is.
+ */
+void TCPSender::update_scoreboard( const TCPReceiverMessage& msg )
+{
+  if ( !sack_ ) {
+    return;
+  }
+  const std::array<SackBlock, TCPReceiverMessage::MAX_SACK_BLOCKS> previous = last_sacks_;
+  const std::span<const SackBlock> seen { previous.data(), last_sack_count_ };
+  last_sack_count_ = 0;
+  for ( const SackBlock& block : msg.sacks() ) {
+    if ( block.begin < window_.base_ || block.end <= block.begin || block.end > window_.next_seq_ ) {
+      continue;
+    }
+    last_sacks_[last_sack_count_++] = block;
+    Wrap32 from = block.begin;
+    while ( from < block.end ) {
+      // skip what a previous block covers; otherwise mark up to where the next previous block starts
+      Wrap32 to = block.end;
+      const auto covering = std::find_if(
+        seen.begin(), seen.end(), [&]( const SackBlock& old ) { return old.begin <= from && from < old.end; } );
+      if ( covering != seen.end() ) {
+        from = covering->end;
+        continue;
+      }
+      for ( const SackBlock& old : seen ) {
+        if ( from < old.begin && old.begin < to ) {
+          to = old.begin;
+        }
+      }
+      mark_sacked( block, from, to );
+      from = to;
+    }
+  }
+  if ( window_.sack_recovery_ && recovery_ == Recovery::FAST ) {
+    mark_holes_lost();
+  }
+}
+
+// mark the segments that overlap [from, to) and that `block` covers whole
+void TCPSender::mark_sacked( const SackBlock& block, Wrap32 from, Wrap32 to )
+{
+  for ( size_t i = retransmit_queue_.first_ending_after( from ); i < retransmit_queue_.size(); ++i ) {
+    RetransmissionQueue::Segment& segment = retransmit_queue_[i];
+    const Wrap32 end_seq = segment.seqno + static_cast<uint32_t>( segment.sequence_length() );
+    if ( segment.seqno >= to || end_seq > block.end ) {
+      break;
+    }
+    if ( segment.seqno < block.begin || segment.sacked ) {
+      continue;
+    }
+    segment.sacked = true;
+    if ( segment.lost ) {
+      segment.lost = false; // already out of the pipe
+    } else {
+      window_.left_network_ += segment.sequence_length();
+    }
+    high_sacked_ = std::max( high_sacked_, end_seq );
+  }
+}
+
+void TCPSender::reset_recovery_cursors()
+{
+  holes_marked_to_ = window_.base_;
+  next_hole_ = window_.base_;
+}
+
+void TCPSender::mark_lost( RetransmissionQueue::Segment& segment )
+{
+  if ( !segment.sacked && !segment.lost ) {
+    segment.lost = true;
+    window_.left_network_ += segment.sequence_length();
+    next_hole_ = std::min( next_hole_, segment.seqno );
+  }
+}
+
+// the segments below the highest SACKed one that aren't SACKed are holes (each is resent once per recovery)
+void TCPSender::mark_holes_lost()
+{
+  for ( size_t i = retransmit_queue_.first_ending_after( holes_marked_to_ ); i < retransmit_queue_.size(); ++i ) {
+    RetransmissionQueue::Segment& segment = retransmit_queue_[i];
+    if ( segment.seqno >= high_sacked_ ) {
+      break;
+    }
+    if ( !segment.retransmitted ) {
+      mark_lost( segment );
+    }
+  }
+  holes_marked_to_ = std::max( holes_marked_to_, high_sacked_ );
+}
+
+void TCPSender::clear_lost()
+{
+  for ( size_t i = 0; i < retransmit_queue_.size(); ++i ) {
+    RetransmissionQueue::Segment& segment = retransmit_queue_[i];
+    if ( segment.lost ) {
+      segment.lost = false;
+      window_.left_network_ -= segment.sequence_length();
+    }
+  }
+}
+
+void TCPSender::retransmit( RetransmissionQueue::Segment& segment, const TransmitFunction& transmit )
+{
+  TCPSenderMessage msg;
+  const Reader::ChunkLoan loan = get_retransmit_msg( segment, msg );
+  transmit( msg );
+  segment.retransmitted = true;
+  if ( segment.lost ) {
+    segment.lost = false; // back in the pipe
+    window_.left_network_ -= segment.sequence_length();
+  }
+}
+
+void TCPSender::retransmit_first( const TransmitFunction& transmit )
+{
+  if ( retransmit_queue_.empty() ) {
+    return;
+  }
+  retransmit( retransmit_queue_.front(), transmit );
+}
+
+// resend the holes, oldest first, as far as the congestion window allows (RFC 6675 NextSeg() rule 1)
+void TCPSender::retransmit_holes( const TransmitFunction& transmit )
+{
+  size_t i = retransmit_queue_.first_ending_after( next_hole_ );
+  for ( ; i < retransmit_queue_.size(); ++i ) {
+    RetransmissionQueue::Segment& segment = retransmit_queue_[i];
+    if ( !segment.lost ) {
+      continue;
+    }
+    if ( window_.congestion_room() < segment.sequence_length() ) {
+      break;
+    }
+    retransmit( segment, transmit );
+  }
+  next_hole_ = i < retransmit_queue_.size() ? retransmit_queue_[i].seqno : window_.next_seq_;
+}
+
+void TCPSender::update_congestion_window()
+{
+  window_.congestion_window_ = congestion_control_ ? congestion_control_->window() : UINT64_MAX;
 }
 
 void TCPSender::segment_control_remove_for_ack( const TCPReceiverMessage& msg )
 {
-  auto it = retransmit_msgs_.begin();
-  while ( it != retransmit_msgs_.end() ) {
-    uint32_t tail_seq = it->seqno.raw_value() + it->sequence_length() - 1;
-    if ( tail_seq < msg.ackno.value().raw_value() ) {
-      reader().pop( it->payload.size() );
-      it = retransmit_msgs_.erase( it );
+  // time the newest segment this ack covers, unless the ack covers any retransmitted segment (Karn's algorithm:
+  // the ack may have been sent when the retransmission filled a hole, long after the newest segment arrived)
+  std::optional<uint64_t> rtt_ms;
+  bool covers_retransmission = false;
+  while ( !retransmit_queue_.empty() ) {
+    const RetransmissionQueue::Segment& segment = retransmit_queue_.front();
+    const Wrap32 end_seq = segment.seqno + static_cast<uint32_t>( segment.sequence_length() );
+    if ( end_seq <= msg.ackno.value() ) {
+      covers_retransmission |= segment.retransmitted;
+      if ( segment.sacked || segment.lost ) {
+        window_.left_network_ -= segment.sequence_length();
+      }
+      rtt_ms = now_ms_ - segment.sent_ms;
+      reader().pop( segment.length );
+      retransmit_queue_.pop_front();
     } else {
       break;
     }
   }
+  if ( timestamps_in_use() && msg.timestamp_echo.has_value() ) {
+    // with timestamps, the ack echoes the TSval of the segment that made the receiver send it, so it times even
+    // a retransmission (RFC 7323, section 4)
+    const auto echo_age = static_cast<int32_t>( static_cast<uint32_t>( now_ms_ ) - msg.timestamp_echo.value() );
+    if ( echo_age >= 0 ) {
+      rtt_sample( static_cast<uint64_t>( echo_age ) );
+    }
+  } else if ( rtt_ms.has_value() && !covers_retransmission ) {
+    rtt_sample( *rtt_ms );
+  }
+}
+
+void TCPSender::rtt_sample( uint64_t rtt_ms )
+{
+  if ( rtt_.has_value() ) {
+    rtt_->sample( rtt_ms );
+    timer_.initial_RTO_ms_ = rtt_->RTO_ms();
+  }
+}
+
+uint16_t TCPSender::next_payload_size() const
+{
+  const uint64_t min_in_pending_or_space
+    = std::min( pending_processed2segment_bytes(), window_.available_send_space() );
+  return static_cast<uint16_t>( std::min( min_in_pending_or_space, uint64_t { max_payload_ } ) );
+}
+
+Reader::ChunkLoan TCPSender::get_next_payload( std::string& payload )
+{
+  return take_payload( Wrap32::distance( window_.base_, window_.next_seq_ ), next_payload_size(), payload );
+}
+
+/**
+ * @brief gather `len` bytes starting `buffer_offset` bytes into the outbound stream's buffer, which may span
+ * several contiguous runs of the stream (ring wrap point or chunk boundaries)
+ */
+std::string TCPSender::read_payload( uint64_t buffer_offset, uint16_t len ) const
+{
+  std::string payload;
+  payload.reserve( len );
+  while ( payload.size() < len ) {
+    const std::string_view run = reader().peek( buffer_offset + payload.size() );
+    if ( run.empty() ) {
+      break;
+    }
+    payload += run.substr( 0, len - payload.size() );
+  }
+  return payload;
+}
+
+/**
+ * @brief the payload of a segment about to be sent: when its bytes are exactly one chunk of the outbound stream,
+ * that chunk is lent to the message instead of copied, and goes back to the stream when the returned loan ends
+ */
+Reader::ChunkLoan TCPSender::take_payload( uint64_t buffer_offset, uint16_t len, std::string& payload )
+{
+  Reader::ChunkLoan loan = reader().lend_chunk( buffer_offset, len, payload );
+  if ( !loan ) {
+    payload = read_payload( buffer_offset, len );
+  }
+  return loan;
+}
+
+Reader::ChunkLoan TCPSender::get_retransmit_msg( const RetransmissionQueue::Segment& segment,
+                                                 TCPSenderMessage& msg )
+{
+  msg.seqno = segment.seqno;
+  msg.SYN = segment.SYN;
+  Reader::ChunkLoan loan
+    = take_payload( segment.stream_index - reader().bytes_popped(), segment.length, msg.payload );
+  msg.FIN = segment.FIN;
+  stamp( msg );
+  return loan;
+}
+
+void TCPSender::RTTEstimator::sample( uint64_t rtt_ms )
+{
+  if ( !scaled_srtt_.has_value() ) {
+    // first measurement: SRTT = R, RTTVAR = R/2
+    scaled_srtt_ = rtt_ms * 8;
+    scaled_rttvar_ = rtt_ms * 2;
+  } else {
+    // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, then SRTT = 7/8 SRTT + 1/8 R
+    const uint64_t srtt = *scaled_srtt_ / 8;
+    const uint64_t deviation = srtt > rtt_ms ? srtt - rtt_ms : rtt_ms - srtt;
+    scaled_rttvar_ = scaled_rttvar_ - scaled_rttvar_ / 4 + deviation;
+    *scaled_srtt_ = *scaled_srtt_ - *scaled_srtt_ / 8 + rtt_ms;
+  }
+  const uint64_t RTO_ms = *scaled_srtt_ / 8 + std::max( CLOCK_GRANULARITY_MS, scaled_rttvar_ );
+  RTO_ms_ = std::clamp( RTO_ms, min_RTO_ms_, max_RTO_ms_ );
+}
+
+std::optional<uint64_t> TCPSender::RTTEstimator::smoothed_RTT_ms() const
+{
+  return scaled_srtt_.has_value() ? std::optional { *scaled_srtt_ / 8 } : std::nullopt;
 }
 
-std::string_view TCPSender::get_next_payload() const
+void TCPSender::RetransmissionQueue::push_back( const Segment& segment )
 {
-  uint32_t bytes_start = this->window_.next_seq_.raw_value() - this->window_.base_.raw_value();
-  std::string_view payload = reader().peek().substr( bytes_start, bytes_start + pending_processed2segment_bytes() );
-  uint16_t min_in_payload_or_space
-    = std::min( static_cast<uint16_t>( payload.size() ), window_.available_send_space() );
-  uint16_t min = std::min( min_in_payload_or_space, static_cast<uint16_t>( TCPConfig::MAX_PAYLOAD_SIZE ) );
-  std::string_view fill_window_payload = payload.substr( 0, min );
-  return fill_window_payload;
+  if ( size_ == ring_.size() ) {
+    // full: unroll into a ring twice the size, oldest segment first
+    std::vector<Segment> grown( std::max( ring_.size() * 2, size_t { 16 } ) );
+    for ( size_t i = 0; i < size_; ++i ) {
+      grown[i] = ring_[( head_ + i ) & ( ring_.size() - 1 )];
+    }
+    ring_ = std::move( grown );
+    head_ = 0;
+  }
+  ring_[( head_ + size_ ) & ( ring_.size() - 1 )] = segment;
+  ++size_;
 }
 
-TCPSenderMessage TCPSender::get_retransmit_msg() const
+size_t TCPSender::RetransmissionQueue::first_ending_after( Wrap32 seqno ) const
 {
-  auto it = retransmit_msgs_.begin();
-  if ( it == retransmit_msgs_.end() ) {
-    throw std::runtime_error( "No retransmit message found for the given sequence number" );
+  size_t low = 0;
+  size_t high = size_;
+  while ( low < high ) {
+    const size_t middle = low + ( high - low ) / 2;
+    const Segment& segment = ( *this )[middle];
+    if ( segment.seqno + static_cast<uint32_t>( segment.sequence_length() ) > seqno ) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
   }
-  return *it;
+  return low;
 }
 
-TCPSenderMessage TCPSender::get_timeout_msg() const
+void TCPSender::RetransmissionQueue::pop_front()
 {
-  return get_retransmit_msg();
+  head_ = ( head_ + 1 ) & ( ring_.size() - 1 );
+  --size_;
 }
 
 void TCPSender::Timer::tick( uint64_t ms_since_last_tick )
@@ -306,7 +773,8 @@ bool TCPSender::Timer::timeout()
 {
   bool is_time_out = passed_time_ >= RTO_ms_;
   if ( is_time_out ) {
-    RTO_ms_ *= 2;
+    RTO_ms_ = std::min( RTO_ms_ * 2, max_RTO_ms_ );
+    retransmissions_++;
   }
   return is_time_out;
 }
@@ -314,6 +782,7 @@ bool TCPSender::Timer::timeout()
 void TCPSender::Timer::reset()
 {
   RTO_ms_ = initial_RTO_ms_;
+  retransmissions_ = 0;
 }
 
 void TCPSender::Timer::start_if_stopped()
@@ -1,14 +1,21 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <functional>
-#include <list>
-#include <string_view>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 
 class TCPSender
 {
@@ -18,18 +25,41 @@ public:
     : input_( std::move( input ) )
     , isn_( isn )
     , initial_RTO_ms_( initial_RTO_ms )
-    , retransmit_msgs_( std::list<TCPSenderMessage>() )
+    , retransmit_queue_()
     , window_( isn )
     , is_syn_sent_( false )
     , timer_( initial_RTO_ms )
     , kSenderState_( SenderState::CLOSED )
   {}
 
+  /* Construct TCP sender from a TCPConfig: its ISN, its Retransmission Timeout (which, with adaptive_rto, follows
+     the measured round-trip time as in RFC 6298, within [rt_timeout_min, rt_timeout_max]), and its congestion
+     control */
+  TCPSender( ByteStream&& input, const TCPConfig& config );
+
+  /* The peer's SYN arrived, with its window-scale option if any: from the next ack on, its windows are scaled
+     by that shift count (RFC 7323), if our SYN offered window scaling too. A SYN-ACK offers it only if the
+     peer's SYN did. */
+  void set_peer_window_scale( std::optional<uint8_t> window_scale );
+
+  /* The peer's SYN arrived, with or without SACK-Permitted: a SYN-ACK offers SACK only if the peer's SYN did
+     (RFC 2018) */
+  void set_peer_sack_permitted( bool sack_permitted );
+
+  /* The peer's SYN arrived, with or without the timestamps option: if both SYNs carry it, every later segment
+     is stamped with the sender's clock, and every ack's echo of it is an RTT sample (RFC 7323) */
+  void set_peer_timestamps( bool timestamps );
+
+  /* The peer's SYN arrived, with its MSS option if any (without one, the peer accepts 536 bytes): from then on,
+     segments carry no more than that, or our own MSS, less the options every segment carries */
+  void set_peer_mss( std::optional<uint16_t> mss );
+
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage make_empty_message() const;
 
-  /* Receive and process a TCPReceiverMessage from the peer's receiver */
-  void receive( const TCPReceiverMessage& msg );
+  /* Receive and process a TCPReceiverMessage from the peer's receiver (`pure_ack`: the segment that carried it
+     had no data of its own, so a repeat of the last ackno is a duplicate ack) */
+  void receive( const TCPReceiverMessage& msg, bool pure_ack = true );
 
   /* Type of the `transmit` function that the push and tick methods can use to send messages */
   using TransmitFunction = std::function<void( const TCPSenderMessage& )>;
@@ -43,6 +73,11 @@ public:
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // For testing: how many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // For testing: how many consecutive retransmissions have happened?
+  uint64_t RTO_ms() const { return timer_.RTO_ms_; } // Current Retransmission Timeout (including any back-off)
+  std::optional<uint64_t> smoothed_RTT_ms() const;  // SRTT, once the RTO adapts and an RTT has been measured
+  uint64_t congestion_window() const { return window_.congestion_window_; } // UINT64_MAX without congestion control
+  const CongestionControl* congestion_control() const { return congestion_control_.get(); }
+  uint16_t max_payload_size() const { return max_payload_; } // the largest payload a segment carries
   const Writer& writer() const { return input_.writer(); }
   const Reader& reader() const { return input_.reader(); }
   Writer& writer() { return input_.writer(); }
@@ -55,11 +90,18 @@ public:
     uint64_t initial_RTO_ms_;
     uint64_t passed_time_;
     uint64_t RTO_ms_;
+    uint64_t max_RTO_ms_;
+    uint64_t retransmissions_;
     bool is_running_;
 
   public:
     Timer( uint64_t initial_RTO_ms )
-      : initial_RTO_ms_( initial_RTO_ms ), passed_time_( 0 ), RTO_ms_( initial_RTO_ms ), is_running_( false ) {};
+      : initial_RTO_ms_( initial_RTO_ms )
+      , passed_time_( 0 )
+      , RTO_ms_( initial_RTO_ms )
+      , max_RTO_ms_( UINT64_MAX )
+      , retransmissions_( 0 )
+      , is_running_( false ) {};
     void tick( uint64_t ms_since_last_tick );
     bool timeout();
     void reset();
@@ -74,15 +116,106 @@ public:
   private:
     Wrap32 base_;
     Wrap32 next_seq_;
-    uint16_t rcv_window_;
+    uint32_t rcv_window_; // the receiver's window, in bytes (scaled up by the peer's window-scale shift count)
+    uint64_t congestion_window_;
+    uint64_t left_network_; // in flight, but SACKed or presumed lost (and not resent), so not in the "pipe"
+    bool sack_recovery_;    // recovering by the SACK scoreboard (RFC 6675): cwnd limits the pipe, not the flight
 
   public:
-    TCPSenderWindow( Wrap32 isn ) : base_( isn ), next_seq_( isn ), rcv_window_( 1 ) {};
-    uint16_t transmitting_bytes_count() const
+    TCPSenderWindow( Wrap32 isn )
+      : base_( isn )
+      , next_seq_( isn )
+      , rcv_window_( 1 )
+      , congestion_window_( UINT64_MAX )
+      , left_network_( 0 )
+      , sack_recovery_( false ) {};
+    uint64_t transmitting_bytes_count() const { return Wrap32::distance( base_, next_seq_ ); }
+    // room left in the congestion window
+    uint64_t congestion_room() const
+    {
+      const uint64_t pipe = transmitting_bytes_count() - ( sack_recovery_ ? left_network_ : 0 );
+      return congestion_window_ > pipe ? congestion_window_ - pipe : 0;
+    }
+    uint64_t receiver_room() const
+    {
+      return rcv_window_ > transmitting_bytes_count() ? rcv_window_ - transmitting_bytes_count() : 0;
+    }
+    // room left in both the receiver's window and the congestion window
+    uint64_t available_send_space() const { return std::min( receiver_room(), congestion_room() ); }
+    // only the congestion window keeps a full segment (of `max_payload` bytes) of the `pending` bytes from going
+    // out: better to wait for the next ack than to send a runt (sender-side silly window avoidance, RFC 1122
+    // 4.2.3.4)
+    bool congestion_limited_runt( uint64_t pending, uint64_t max_payload ) const
     {
-      return static_cast<uint16_t>( next_seq_.raw_value() - base_.raw_value() );
+      const uint64_t room = congestion_room();
+      return transmitting_bytes_count() > 0 && room < max_payload && room < pending && room < receiver_room();
     }
-    uint16_t available_send_space() const { return rcv_window_ - transmitting_bytes_count(); }
+  };
+  /**
+   * @brief RFC 6298 round-trip time estimator: SRTT and RTTVAR are smoothed from the samples (kept as
+   * SRTT*8 and RTTVAR*4, as in Jacobson's code, so the 1/8 and 1/4 gains stay in integers), and the RTO
+   * is SRTT + max( G, 4*RTTVAR ) clamped to [min_RTO_ms, max_RTO_ms]
+   */
+  class RTTEstimator
+  {
+  private:
+    uint64_t min_RTO_ms_;
+    uint64_t max_RTO_ms_;
+    uint64_t RTO_ms_;
+    std::optional<uint64_t> scaled_srtt_ {};
+    uint64_t scaled_rttvar_ {};
+
+  public:
+    static constexpr uint64_t CLOCK_GRANULARITY_MS = 1; // G: the sender's clock ticks in milliseconds
+
+    RTTEstimator( uint64_t initial_RTO_ms, uint64_t min_RTO_ms, uint64_t max_RTO_ms )
+      : min_RTO_ms_( min_RTO_ms ), max_RTO_ms_( max_RTO_ms ), RTO_ms_( initial_RTO_ms ) {};
+    void sample( uint64_t rtt_ms );
+    uint64_t RTO_ms() const { return RTO_ms_; }
+    std::optional<uint64_t> smoothed_RTT_ms() const;
+    uint64_t RTT_variation_ms() const { return scaled_rttvar_ / 4; }
+  };
+  /**
+   * @brief the outstanding segments, oldest first. The payloads stay in the outbound stream until they are
+   * acknowledged, so each segment is kept as a record of where its bytes are, and re-sliced from the stream
+   * when it has to be retransmitted. The records live in a ring that only grows (to a power of two).
+   */
+  class RetransmissionQueue
+  {
+    friend class TCPSender;
+
+  public:
+    struct Segment
+    {
+      Wrap32 seqno { 0 };
+      uint64_t stream_index {}; // index in the outbound stream of the first payload byte
+      uint16_t length {};       // payload bytes
+      bool SYN {};
+      bool FIN {};
+      uint64_t sent_ms {};      // sender's clock when first transmitted
+      bool retransmitted {};    // once retransmitted, an ack can't tell which transmission it answers (Karn)
+      bool sacked {};           // the receiver holds it (a SACK block covers it), though it isn't acked yet
+      bool lost {};             // presumed lost (a hole below SACKed data, or after a timeout) and not resent
+
+      uint64_t sequence_length() const { return SYN + length + FIN; }
+    };
+
+  private:
+    std::vector<Segment> ring_ {};
+    size_t head_ {};
+    size_t size_ {};
+
+  public:
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+    Segment& front() { return ring_[head_]; }
+    const Segment& front() const { return ring_[head_]; }
+    Segment& operator[]( size_t i ) { return ring_[( head_ + i ) & ( ring_.size() - 1 )]; }
+    const Segment& operator[]( size_t i ) const { return ring_[( head_ + i ) & ( ring_.size() - 1 )]; }
+    // index of the first segment that ends after `seqno` (size() if none does), by binary search
+    size_t first_ending_after( Wrap32 seqno ) const;
+    void push_back( const Segment& segment );
+    void pop_front();
   };
 
 private:
@@ -90,10 +223,43 @@ private:
   ByteStream input_;
   Wrap32 isn_;
   uint64_t initial_RTO_ms_;
-  std::list<TCPSenderMessage> retransmit_msgs_;
+  RetransmissionQueue retransmit_queue_;
   TCPSenderWindow window_;
   bool is_syn_sent_;
   Timer timer_;
+  std::optional<RTTEstimator> rtt_ {}; // only when the RTO adapts to the measured RTT
+  std::unique_ptr<CongestionControl> congestion_control_ {}; // none: only the receiver's window limits sending
+  CongestionControl::Algorithm congestion_algorithm_ { CongestionControl::Algorithm::None };
+  static constexpr uint64_t DUPLICATE_ACK_THRESHOLD = 3;
+  bool fast_retransmit_ {};
+  uint64_t duplicate_acks_ {};      // consecutive duplicate acks of base_
+  bool retransmit_pending_ {};      // retransmit the first outstanding segment at the next push()
+  enum class Recovery
+  {
+    NONE,
+    FAST,    // after a fast retransmit, until everything outstanding then is acked
+    TIMEOUT, // after a timeout, likewise
+  } recovery_ { Recovery::NONE };
+  Wrap32 recover_ { 0 }; // next_seq_ when recovery started
+  bool sack_ {};                     // offer SACK on the SYN and keep a scoreboard of the SACK blocks received
+  std::optional<bool> peer_sack_ {}; // whether the peer's SYN carried SACK-Permitted, once known
+  Wrap32 high_sacked_ { 0 };         // end of the highest SACKed segment
+  // the blocks of the last ack that updated the scoreboard: only what a new ack adds to them needs a look
+  std::array<SackBlock, TCPReceiverMessage::MAX_SACK_BLOCKS> last_sacks_ {};
+  uint8_t last_sack_count_ {};
+  Wrap32 holes_marked_to_ { 0 }; // during SACK recovery, the segments below this have been checked for holes
+  Wrap32 next_hole_ { 0 };       // during SACK recovery, no segment below this is marked lost
+  std::optional<uint8_t> window_scale_ {}; // the shift count our SYN offers (our receiver's), if any
+  uint8_t peer_window_shift_ {};           // the shift count of the windows the peer advertises
+  // whether the peer's SYN offered window scaling, once known
+  std::optional<bool> peer_window_scaling_ {};
+  bool timestamps_ {};                     // stamp our SYN with TSval (and keep stamping if the peer does too)
+  std::optional<bool> peer_timestamps_ {}; // whether the peer's SYN carried the timestamps option, once known
+  static constexpr uint16_t TIMESTAMPS_OPTION_LENGTH = 12; // as sent: two NOPs, then kind, length, TSval, TSecr
+  std::optional<uint16_t> mss_ {};         // the MSS our SYN announces (our receiver's), if any
+  std::optional<uint16_t> peer_mss_ {};    // the peer's MSS, once its SYN has arrived
+  uint16_t max_payload_ { TCPConfig::MAX_PAYLOAD_SIZE };
+  uint64_t now_ms_ {};                 // total of the ms_since_last_tick passed to tick()
   enum class SenderState
   {
     CLOSED,
@@ -105,22 +271,39 @@ private:
   /**
    * @brief 还没有处理成segment待处理的字节数量
    * the bytes that have not yet been processed into segments
-   * @return uint16_t
+   * @return uint64_t
    */
-  uint16_t pending_processed2segment_bytes() const;
-  std::string_view get_next_payload() const;
-  TCPSenderMessage get_retransmit_msg() const;
-  TCPSenderMessage get_timeout_msg() const;
+  uint64_t pending_processed2segment_bytes() const;
+  uint16_t next_payload_size() const;
+  Reader::ChunkLoan get_next_payload( std::string& payload );
+  std::string read_payload( uint64_t buffer_offset, uint16_t len ) const;
+  Reader::ChunkLoan take_payload( uint64_t buffer_offset, uint16_t len, std::string& payload );
+  Reader::ChunkLoan get_retransmit_msg( const RetransmissionQueue::Segment& segment, TCPSenderMessage& msg );
   bool segment_has_next_payload();
   bool segment_after_this_window_has_space( const TCPSenderMessage& current_msg ) const
   {
     return window_.available_send_space() > current_msg.payload.size();
   }
-  void segment_transmit( const TCPSenderMessage& msg, const TransmitFunction& transmit );
-  TCPSenderMessage segment_get_just_contain_payload() const;
+  void segment_transmit( TCPSenderMessage& msg, const TransmitFunction& transmit );
+  Reader::ChunkLoan segment_get_just_contain_payload( TCPSenderMessage& msg );
   void segment_update_state_for_ack( const TCPReceiverMessage& msg );
   void segment_control_remove_for_ack( const TCPReceiverMessage& msg );
   void segment_control_create( const TCPSenderMessage& msg );
+  void rtt_sample( uint64_t rtt_ms );
+  bool timestamps_in_use() const { return timestamps_ && peer_timestamps_.value_or( true ); }
+  void stamp( TCPSenderMessage& msg ) const;
+  void receive_duplicate_ack();
+  void update_scoreboard( const TCPReceiverMessage& msg );
+  void mark_sacked( const SackBlock& block, Wrap32 from, Wrap32 to );
+  void reset_recovery_cursors();
+  void mark_lost( RetransmissionQueue::Segment& segment );
+  void mark_holes_lost();
+  void clear_lost();
+  void retransmit( RetransmissionQueue::Segment& segment, const TransmitFunction& transmit );
+  void retransmit_first( const TransmitFunction& transmit );
+  void retransmit_holes( const TransmitFunction& transmit );
+  void update_congestion_window();
+  void update_max_payload();
   void push_closed_handler( const TransmitFunction& transmit );
   void push_established_handler( const TransmitFunction& transmit );
   void push_established_zero_window_handler( const TransmitFunction& transmit );
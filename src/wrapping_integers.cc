@@ -4,6 +4,17 @@
 
 using namespace std;
 
+namespace {
+/* The absolute number closest to `checkpoint` whose low 32 bits are `offset` (the lower one on a tie) */
+inline uint64_t closest_to_checkpoint( uint32_t offset, uint64_t checkpoint )
+{
+  /* Step from the checkpoint by the signed 32-bit distance; step up 2^32 instead if that goes below zero */
+  const int64_t delta = static_cast<int32_t>( offset - static_cast<uint32_t>( checkpoint ) );
+  const uint64_t below_zero = static_cast<uint64_t>( delta < 0 && checkpoint < static_cast<uint64_t>( -delta ) );
+  return checkpoint + static_cast<uint64_t>( delta ) + ( below_zero << 32 );
+}
+} // namespace
+
 Wrap32 Wrap32::wrap( uint64_t n, Wrap32 zero_point )
 {
   return Wrap32 { zero_point + n };
@@ -11,12 +22,12 @@ Wrap32 Wrap32::wrap( uint64_t n, Wrap32 zero_point )
 
 uint64_t Wrap32::unwrap( Wrap32 zero_point, uint64_t checkpoint ) const
 {
-  uint64_t low_bits = static_cast<uint64_t>( raw_value_ - zero_point.raw_value_ );
-  uint64_t high_bits_upper = ( checkpoint + ( 1UL << 31 ) ) & ( UINT64_MAX - UINT32_MAX );
-  uint64_t high_bits_lower = ( checkpoint - ( 1UL << 31 ) ) & ( UINT64_MAX - UINT32_MAX );
-  uint64_t upper = high_bits_upper | low_bits;
-  uint64_t lower = high_bits_lower | low_bits;
-  uint64_t distance_upper = max( checkpoint, upper ) - min( checkpoint, upper );
-  uint64_t distance_lower = max( checkpoint, lower ) - min( checkpoint, lower );
-  return distance_upper < distance_lower ? upper : lower;
+  return closest_to_checkpoint( raw_value_ - zero_point.raw_value_, checkpoint );
+}
+
+void Wrap32::unwrap( span<const Wrap32> seqnos, Wrap32 zero_point, uint64_t checkpoint, span<uint64_t> absolute )
+{
+  for ( size_t i = 0; i < seqnos.size(); ++i ) {
+    absolute[i] = closest_to_checkpoint( seqnos[i].raw_value_ - zero_point.raw_value_, checkpoint );
+  }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 
 /*
  * The Wrap32 type represents a 32-bit unsigned integer that:
@@ -11,7 +12,7 @@
 class Wrap32
 {
 public:
-  explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
+  explicit constexpr Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
 
   /* Construct a Wrap32 given an absolute sequence number n and the zero point. */
   static Wrap32 wrap( uint64_t n, Wrap32 zero_point );
@@ -25,9 +26,35 @@ public:
    */
   uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const;
 
-  Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
-  bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
-  uint32_t raw_value() const { return raw_value_; }
+  /*
+   * Unwrap each of `seqnos` (as above, all against the same zero point and checkpoint) into `absolute`,
+   * which must be at least as long. The loop has no branches, so the compiler can vectorize it.
+   */
+  static void unwrap( std::span<const Wrap32> seqnos,
+                      Wrap32 zero_point,
+                      uint64_t checkpoint,
+                      std::span<uint64_t> absolute );
+
+  constexpr Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
+  constexpr bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
+  constexpr uint32_t raw_value() const { return raw_value_; }
+
+  /*
+   * Serial number arithmetic (RFC 1982): `b - a` is how far b lies after a (negative if before), taking
+   * the shorter way around the circle, and a < b when b lies less than 2^31 after a. When a and b are
+   * exactly 2^31 apart, neither is after the other, and both a < b and b < a are false.
+   */
+  constexpr int32_t operator-( Wrap32 other ) const
+  {
+    return static_cast<int32_t>( raw_value_ - other.raw_value_ );
+  }
+  constexpr bool operator<( Wrap32 other ) const { return other - *this > 0; }
+  constexpr bool operator>( Wrap32 other ) const { return other < *this; }
+  constexpr bool operator<=( Wrap32 other ) const { return *this == other or *this < other; }
+  constexpr bool operator>=( Wrap32 other ) const { return *this == other or *this > other; }
+
+  /* How many steps forward it takes to get from `from` to `to` (always going forward, so in [0, 2^32)). */
+  static constexpr uint32_t distance( Wrap32 from, Wrap32 to ) { return to.raw_value_ - from.raw_value_; }
 
 protected:
   uint32_t raw_value_ {};
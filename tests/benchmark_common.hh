@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The plumbing shared by the benchmarks: a heap allocation counter, their command line, and their JSON and CSV
+// output. Each benchmark is a single translation unit, which is the only one that includes this header (it
+// replaces the global operator new).
+
+// Every heap allocation made by the program is counted and sized, so each run can report its allocations and
+// how much memory it held at its peak
+namespace benchmark {
+inline std::atomic<uint64_t> allocation_count {};
+inline std::atomic<int64_t> heap_bytes {};
+inline std::atomic<int64_t> peak_heap_bytes {};
+} // namespace benchmark
+
+void* operator new( size_t size )
+{
+  void* ptr = malloc( size == 0 ? 1 : size ); // NOLINT(*-no-malloc, *-owning-memory)
+  if ( not ptr ) {
+    throw std::bad_alloc();
+  }
+  benchmark::allocation_count.fetch_add( 1, std::memory_order_relaxed );
+  const auto usable = static_cast<int64_t>( malloc_usable_size( ptr ) );
+  const int64_t now = benchmark::heap_bytes.fetch_add( usable, std::memory_order_relaxed ) + usable;
+  int64_t peak = benchmark::peak_heap_bytes.load( std::memory_order_relaxed );
+  while ( now > peak and not benchmark::peak_heap_bytes.compare_exchange_weak( peak, now ) ) {}
+  return ptr;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  if ( ptr ) {
+    benchmark::heap_bytes.fetch_sub( static_cast<int64_t>( malloc_usable_size( ptr ) ),
+                                     std::memory_order_relaxed );
+  }
+  free( ptr ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  operator delete( ptr );
+}
+
+namespace benchmark {
+
+// Random bytes to push through a stream
+inline std::string make_data( size_t len, size_t random_seed )
+{
+  std::default_random_engine rd { random_seed };
+  std::uniform_int_distribution<char> ud;
+  std::string ret;
+  ret.reserve( len );
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// The one option that sets how much work each configuration does, e.g. `--bytes <n>`
+struct SizeOption
+{
+  std::string name;
+  uint64_t default_value;
+  std::string description; // what <n> does, e.g. "Move <n> bytes through the stream in each configuration"
+};
+
+struct Options
+{
+  uint64_t size;
+  std::string json_path;
+  std::string csv_path;
+};
+
+inline void show_usage( const char* argv0, const SizeOption& size )
+{
+  const std::string size_flag = "--" + size.name + " <n>";
+  std::cerr << "Usage: " << argv0 << " [" << size_flag << "] [--json <file>] [--csv <file>]\n\n"
+            << "  " << std::left << std::setw( 15 ) << size_flag << size.description << " (default "
+            << size.default_value << ")\n"
+            << "  --json <file>  Also write the results as JSON to <file>\n"
+            << "  --csv <file>   Also write the results as CSV to <file>\n";
+}
+
+inline Options parse_options( std::span<char*> args, const SizeOption& size )
+{
+  Options options { size.default_value, {}, {} };
+  for ( size_t i = 1; i < args.size(); i += 2 ) {
+    if ( i + 1 == args.size() ) {
+      show_usage( args[0], size );
+      throw std::runtime_error( "missing argument to " + std::string( args[i] ) );
+    }
+    if ( args[i] == "--" + size.name ) {
+      options.size = strtoull( args[i + 1], nullptr, 0 );
+    } else if ( strcmp( args[i], "--json" ) == 0 ) {
+      options.json_path = args[i + 1];
+    } else if ( strcmp( args[i], "--csv" ) == 0 ) {
+      options.csv_path = args[i + 1];
+    } else {
+      show_usage( args[0], size );
+      throw std::runtime_error( "unrecognized option " + std::string( args[i] ) );
+    }
+  }
+  return options;
+}
+
+// A named value in a result, already formatted for JSON (strings quoted) and for CSV
+struct Field
+{
+  std::string name;
+  std::string json;
+  std::string csv;
+};
+
+using Fields = std::vector<Field>;
+
+// Floating-point values get three decimal places
+template<typename T>
+Field field( std::string name, const T& value )
+{
+  if constexpr ( std::is_same_v<T, bool> ) {
+    return { std::move( name ), value ? "true" : "false", value ? "true" : "false" };
+  } else if constexpr ( std::is_arithmetic_v<T> ) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision( 3 ) << value;
+    return { std::move( name ), text.str(), text.str() };
+  } else {
+    const std::string text { value };
+    return { std::move( name ), '"' + text + '"', text };
+  }
+}
+
+// `parameters` describe the whole run (e.g. the input size); each of `rows` is one configuration's result
+inline void write_json( const std::string& path,
+                        std::string_view benchmark_name,
+                        const Fields& parameters,
+                        const std::vector<Fields>& rows )
+{
+  std::ofstream out { path };
+  out << "{\n  \"benchmark\": \"" << benchmark_name << "\",\n  \"compiler\": \"" << __VERSION__ << "\",\n";
+  for ( const Field& f : parameters ) {
+    out << "  \"" << f.name << "\": " << f.json << ",\n";
+  }
+  out << "  \"results\": [\n";
+  for ( size_t i = 0; i < rows.size(); ++i ) {
+    out << "    {";
+    for ( size_t j = 0; j < rows[i].size(); ++j ) {
+      out << ( j ? ", " : " " ) << "\"" << rows[i][j].name << "\": " << rows[i][j].json;
+    }
+    out << " }" << ( i + 1 < rows.size() ? "," : "" ) << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+inline void write_csv( const std::string& path, const std::vector<Fields>& rows )
+{
+  std::ofstream out { path };
+  if ( rows.empty() ) {
+    return;
+  }
+  for ( size_t j = 0; j < rows.front().size(); ++j ) {
+    out << ( j ? "," : "" ) << rows.front()[j].name;
+  }
+  out << "\n";
+  for ( const Fields& row : rows ) {
+    for ( size_t j = 0; j < row.size(); ++j ) {
+      out << ( j ? "," : "" ) << row[j].csv;
+    }
+    out << "\n";
+  }
+}
+
+// Write the results to the files named on the command line, if any, each result as the Fields `to_fields` makes
+template<typename Result, typename ToFields>
+void write_results( const Options& options,
+                    std::string_view benchmark_name,
+                    const Fields& parameters,
+                    const std::vector<Result>& results,
+                    ToFields&& to_fields )
+{
+  std::vector<Fields> rows;
+  rows.reserve( results.size() );
+  for ( const Result& r : results ) {
+    rows.push_back( to_fields( r ) );
+  }
+  if ( not options.json_path.empty() ) {
+    write_json( options.json_path, benchmark_name, parameters, rows );
+  }
+  if ( not options.csv_path.empty() ) {
+    write_csv( options.csv_path, rows );
+  }
+}
+
+} // namespace benchmark
@@ -0,0 +1,101 @@
+#include "buffer_pool.hh"
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "BufferPool: expected " + what );
+  }
+}
+
+void size_classes()
+{
+  expect( BufferPool::size_class( 1500 ) == 0, "a packet-sized request to use a 2 KiB block" );
+  expect( BufferPool::size_class( 64000 ) == 1, "a stream-sized request to use a 64 KiB block" );
+  expect( BufferPool::size_class( 100 ) == -1, "a small request to go to the heap" );
+  expect( BufferPool::size_class( 4096 ) == -1, "a request that would waste a 64 KiB block to go to the heap" );
+  expect( BufferPool::size_class( 1 << 20 ) == -1, "a request bigger than any block to go to the heap" );
+}
+
+void reuse()
+{
+  void* const first = BufferPool::allocate( 0 );
+  BufferPool::deallocate( first, 0 );
+  void* const second = BufferPool::allocate( 0 );
+  expect( first == second, "a freed block to be handed out again by the same thread" );
+  BufferPool::deallocate( second, 0 );
+
+  // many blocks at once come from a few slabs
+  const uint64_t slabs_before = BufferPool::slab_count( 0 );
+  vector<void*> blocks;
+  for ( int i = 0; i < 2000; ++i ) {
+    blocks.push_back( BufferPool::allocate( 0 ) );
+    memset( blocks.back(), i, BufferPool::kBlockSizes[0] );
+  }
+  for ( void* const block : blocks ) {
+    BufferPool::deallocate( block, 0 );
+  }
+  expect( BufferPool::slab_count( 0 ) - slabs_before <= 4, "2000 blocks of 2 KiB to come from at most 4 slabs" );
+}
+
+void refcounting()
+{
+  Buffer a { 1500 };
+  expect( a.size() == 1500 and a.use_count() == 1, "a new Buffer to have its size and one reference" );
+  memcpy( a.data(), "hello", 5 );
+
+  Buffer b = a;
+  expect( b.data() == a.data() and a.use_count() == 2, "a copy to share the bytes" );
+
+  Buffer c = move( b );
+  // NOLINTNEXTLINE(*-use-after-move)
+  expect( b.data() == nullptr and c.use_count() == 2, "a move to transfer the reference" );
+
+  a = Buffer {};
+  expect( c.use_count() == 1 and string( c.data(), 5 ) == "hello", "the bytes to outlive the first handle" );
+
+  const Buffer big { 1 << 20 };
+  expect( big.size() == 1 << 20, "a Buffer bigger than any block to come from the heap" );
+}
+
+void cross_thread()
+{
+  // blocks allocated by one thread and freed by another (and strings using the pool) are fine
+  vector<Buffer> buffers( 500, Buffer { 1500 } );
+  for ( int i = 0; i < 500; ++i ) {
+    buffers[i] = Buffer { Buffer::kMaxPooledSize };
+  }
+  thread other( [&] { buffers.clear(); } );
+  other.join();
+
+  PooledString s( 1500, 'x' );
+  thread copier( [&] {
+    const PooledString copy = s;
+    expect( copy == s, "a PooledString copy to be equal" );
+  } );
+  copier.join();
+}
+
+int main()
+{
+  try {
+    size_classes();
+    reuse();
+    refcounting();
+    cross_thread();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
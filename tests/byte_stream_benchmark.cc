@@ -0,0 +1,234 @@
+#include "benchmark_common.hh"
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "spsc_byte_stream.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+struct Config
+{
+  string mode;    // "single-thread" (ByteStream) or "cross-thread" (SPSCByteStream, producer and consumer threads)
+  string storage; // ByteStream storage mode, or "SPSC"
+  size_t capacity;
+  size_t write_size; // bytes per push
+  size_t read_size;  // bytes per peek and pop
+};
+
+struct Result
+{
+  Config config;
+  size_t bytes;         // bytes moved through the stream
+  double seconds;       // wall-clock time to move them
+  uint64_t operations;  // pushes and pops (counting only those that moved bytes)
+  uint64_t allocations; // heap allocations made while moving them
+
+  double gigabits_per_second() const { return 8 * static_cast<double>( bytes ) / seconds / 1e9; }
+  double nanoseconds_per_operation() const { return seconds * 1e9 / static_cast<double>( operations ); }
+  double allocations_per_megabyte() const { return static_cast<double>( allocations ) * 1e6 / bytes; }
+};
+
+void check_output( const string& data, const string& output_data, const Config& config )
+{
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (" + config.mode + ", " + config.storage
+                         + ", capacity=" + to_string( config.capacity ) + ")" );
+  }
+}
+
+// One thread alternately pushes `write_size` bytes (when they fit) and pops up to `read_size` bytes
+Result run_single_thread( const string& data, ByteStream::Storage storage, const Config& config )
+{
+  // Split the data into segments before writing, so that only the stream's own allocations get counted
+  vector<string> split_data;
+  for ( size_t i = 0; i < data.size(); i += config.write_size ) {
+    split_data.emplace_back( data.substr( i, config.write_size ) );
+  }
+
+  ByteStream bs { config.capacity, storage };
+  string output_data;
+  output_data.reserve( data.size() );
+  size_t next_write = 0;
+  uint64_t operations = 0;
+
+  const uint64_t allocations_before = benchmark::allocation_count.load();
+  const auto start_time = steady_clock::now();
+  while ( not bs.reader().is_finished() ) {
+    if ( next_write == split_data.size() ) {
+      if ( not bs.writer().is_closed() ) {
+        bs.writer().close();
+      }
+    } else if ( split_data[next_write].size() <= bs.writer().available_capacity() ) {
+      bs.writer().push( move( split_data[next_write++] ) );
+      ++operations;
+    }
+
+    if ( bs.reader().bytes_buffered() ) {
+      const string_view peeked = bs.reader().peek().substr( 0, config.read_size );
+      output_data += peeked;
+      bs.reader().pop( peeked.size() );
+      ++operations;
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  const uint64_t allocations = benchmark::allocation_count.load() - allocations_before;
+
+  check_output( data, output_data, config );
+  return { config,
+           data.size(),
+           duration_cast<duration<double>>( stop_time - start_time ).count(),
+           operations,
+           allocations };
+}
+
+// A producer thread pushes `write_size` bytes at a time while the consumer pops up to `read_size` at a time,
+// each waking up on the stream's eventfds
+Result run_cross_thread( const string& data, const Config& config )
+{
+  SPSCByteStream bs { config.capacity };
+  string output_data;
+  output_data.reserve( data.size() );
+  atomic<uint64_t> producer_operations {};
+
+  const uint64_t allocations_before = benchmark::allocation_count.load();
+  const auto start_time = steady_clock::now();
+
+  thread producer( [&] {
+    size_t written = 0;
+    uint64_t operations = 0;
+    EventLoop eventloop {};
+    eventloop.add_rule(
+      "push to stream",
+      bs.writable_fd(),
+      Direction::In,
+      [&] {
+        bs.writable_fd().clear();
+        while ( written < data.size() and bs.writer().available_capacity() > 0 ) {
+          written += bs.writer().push( string_view( data ).substr( written, config.write_size ) );
+          ++operations;
+        }
+        if ( written == data.size() ) {
+          bs.writer().close();
+        }
+      },
+      [&] { return not bs.writer().is_closed(); } );
+    while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+    producer_operations = operations;
+  } );
+
+  uint64_t operations = 0;
+  EventLoop eventloop {};
+  eventloop.add_rule(
+    "pop from stream",
+    bs.readable_fd(),
+    Direction::In,
+    [&] {
+      bs.readable_fd().clear();
+      while ( bs.reader().bytes_buffered() ) {
+        const string_view peeked = bs.reader().peek().substr( 0, config.read_size );
+        output_data += peeked;
+        bs.reader().pop( peeked.size() );
+        ++operations;
+      }
+    },
+    [&] { return not bs.reader().is_finished(); } );
+  while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+  producer.join();
+
+  const auto stop_time = steady_clock::now();
+  const uint64_t allocations = benchmark::allocation_count.load() - allocations_before;
+
+  check_output( data, output_data, config );
+  return { config,
+           data.size(),
+           duration_cast<duration<double>>( stop_time - start_time ).count(),
+           operations + producer_operations,
+           allocations };
+}
+
+void print_table_row( const Result& r )
+{
+  cout << left << setw( 15 ) << r.config.mode << setw( 10 ) << r.config.storage << right << setw( 10 )
+       << r.config.capacity << setw( 8 ) << r.config.write_size << setw( 8 ) << r.config.read_size << fixed
+       << setprecision( 2 ) << setw( 10 ) << r.gigabits_per_second() << setw( 10 ) << r.nanoseconds_per_operation()
+       << setw( 12 ) << r.allocations_per_megabyte() << "\n";
+}
+
+benchmark::Fields fields( const Result& r )
+{
+  return { benchmark::field( "mode", r.config.mode ),
+           benchmark::field( "storage", r.config.storage ),
+           benchmark::field( "capacity", r.config.capacity ),
+           benchmark::field( "write_size", r.config.write_size ),
+           benchmark::field( "read_size", r.config.read_size ),
+           benchmark::field( "gbit_per_s", r.gigabits_per_second() ),
+           benchmark::field( "ns_per_op", r.nanoseconds_per_operation() ),
+           benchmark::field( "allocs_per_mb", r.allocations_per_megabyte() ) };
+}
+
+void program_body( span<char*> args )
+{
+  const benchmark::Options options = benchmark::parse_options(
+    args, { "bytes", 10'000'000, "Move <n> bytes through the stream in each configuration" } );
+  const size_t input_len = options.size;
+
+  const string data = benchmark::make_data( input_len, 789 );
+  const vector<pair<string, ByteStream::Storage>> storages { { "Ring", ByteStream::Storage::Ring },
+                                                             { "Chunked", ByteStream::Storage::Chunked },
+                                                             { "Mirrored", ByteStream::Storage::Mirrored },
+                                                             { "Spilled", ByteStream::Storage::Spilled } };
+
+  cout << left << setw( 15 ) << "mode" << setw( 10 ) << "storage" << right << setw( 10 ) << "capacity" << setw( 8 )
+       << "write" << setw( 8 ) << "read" << setw( 10 ) << "Gbit/s" << setw( 10 ) << "ns/op" << setw( 12 )
+       << "allocs/MB"
+       << "\n";
+
+  vector<Result> results;
+  for ( const size_t capacity : { 4096UL, 65536UL, 1048576UL, 16777216UL } ) {
+    for ( const size_t write_size : { 64UL, 1500UL, 65536UL } ) {
+      if ( write_size > capacity ) {
+        continue; // a push that never fits would never finish
+      }
+      for ( const size_t read_size : { 32UL, 4096UL, 65536UL } ) {
+        for ( const auto& [name, storage] : storages ) {
+          results.push_back(
+            run_single_thread( data, storage, { "single-thread", name, capacity, write_size, read_size } ) );
+          print_table_row( results.back() );
+        }
+        results.push_back( run_cross_thread( data, { "cross-thread", "SPSC", capacity, write_size, read_size } ) );
+        print_table_row( results.back() );
+      }
+    }
+  }
+
+  benchmark::write_results(
+    options, "byte_stream", { benchmark::field( "input_bytes", input_len ) }, results, fields );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    program_body( span( argv, argc ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -77,9 +77,10 @@ double speed_test( fstream& debug_output,
        << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
 
   auto read_s = to_string( read_size );
-  const string fill( 5 - read_s.size(), ' ' );
-  debug_output << "        ByteStream throughput (pop length " << read_s << "):" << fill << fixed
-               << setprecision( 2 ) << setw( 5 ) << gigabits_per_second << " Gbit/s\n";
+  auto capacity_s = to_string( capacity );
+  const string fill( 14 - read_s.size() - capacity_s.size(), ' ' );
+  debug_output << "        ByteStream throughput (capacity " << capacity_s << ", pop length " << read_s
+               << "):" << fill << fixed << setprecision( 2 ) << setw( 5 ) << gigabits_per_second << " Gbit/s\n";
 
   if ( gigabits_per_second < 0.1 ) {
     throw runtime_error( "ByteStream did not meet minimum speed of 0.1 Gbit/s" );
@@ -96,6 +97,11 @@ void program_body()
   speed_test( debug_output, 1e7, 32768, 789, 1500, 4096 );
   speed_test( debug_output, 1e7, 32768, 789, 1500, 128 );
   speed_test( debug_output, 1e7, 32768, 789, 1500, 32 );
+
+  // Sweep the capacity: the cost of a push or pop should not depend on how much is buffered
+  for ( const size_t capacity : { 4096UL, 65536UL, 1048576UL, 16777216UL } ) {
+    speed_test( debug_output, 1e7, capacity, 789, 1500, 4096 );
+  }
 }
 
 int main()
@@ -0,0 +1,118 @@
+#include "spsc_byte_stream.hh"
+
+#include "eventloop.hh"
+
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "SPSCByteStream: expected " + what );
+  }
+}
+
+void single_thread()
+{
+  SPSCByteStream bs { 8 };
+
+  expect( bs.writer().push( "abcdef" ) == 6, "push of 6 bytes to succeed" );
+  bs.reader().pop( 4 );
+  expect( bs.writer().push( "ghijklmn" ) == 6, "push to stop at capacity" );
+  expect( bs.writer().available_capacity() == 0, "no available capacity" );
+  expect( bs.reader().peek() == "efgh", "peek to stop at the wrap point" );
+
+  string got;
+  for ( const auto region : bs.reader().peek_all() ) {
+    got += region;
+  }
+  expect( got == "efghijkl", "peek_all to return every buffered byte" );
+
+  bs.reader().pop( 8 );
+  bs.writer().close();
+  expect( bs.reader().is_finished(), "stream to be finished" );
+  expect( bs.reader().bytes_popped() == 12, "12 bytes popped" );
+}
+
+void cross_thread( size_t input_len, size_t capacity, size_t random_seed )
+{
+  const string data = [&] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  SPSCByteStream bs { capacity };
+
+  thread producer( [&] {
+    default_random_engine rd { random_seed + 1 };
+    uniform_int_distribution<size_t> write_size { 1, 3000 };
+    size_t written = 0;
+
+    EventLoop eventloop {};
+    eventloop.add_rule(
+      "push to stream",
+      bs.writable_fd(),
+      Direction::In,
+      [&] {
+        bs.writable_fd().clear();
+        while ( written < data.size() and bs.writer().available_capacity() > 0 ) {
+          written += bs.writer().push( string_view( data ).substr( written, write_size( rd ) ) );
+        }
+        if ( written == data.size() ) {
+          bs.writer().close();
+        }
+      },
+      [&] { return not bs.writer().is_closed(); } );
+    while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+  } );
+
+  default_random_engine rd { random_seed + 2 };
+  uniform_int_distribution<size_t> read_size { 1, 5000 };
+  string output_data;
+
+  EventLoop eventloop {};
+  eventloop.add_rule(
+    "pop from stream",
+    bs.readable_fd(),
+    Direction::In,
+    [&] {
+      bs.readable_fd().clear();
+      while ( bs.reader().bytes_buffered() ) {
+        const string_view peeked = bs.reader().peek().substr( 0, read_size( rd ) );
+        output_data += peeked;
+        bs.reader().pop( peeked.size() );
+      }
+    },
+    [&] { return not bs.reader().is_finished(); } );
+  while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+
+  producer.join();
+  expect( output_data == data, "the bytes read to match the bytes written" );
+}
+
+int main()
+{
+  try {
+    single_thread();
+    cross_thread( 1'000'000, 4096, 17 );
+    cross_thread( 1'000'000, 65536, 18 );
+    cross_thread( 10'000, 1, 19 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+void wraparound( ByteStream::Storage storage )
+{
+  ByteStreamTestHarness test { "wraparound/" + storage_name( storage ), 8, storage };
+
+  test.execute( Push { "abcdef" } );
+  test.execute( Pop { 4 } );
+  test.execute( Push { "ghijklmn" } );
+  test.execute( BytesPushed { 12 } );
+  test.execute( AvailableCapacity { 0 } );
+  test.execute( BytesBuffered { 8 } );
+  test.execute( Peek { "efghijkl" } );
+  test.execute( PeekAll { "efghijkl" } );
+  test.execute( PeekAt { 7, "l" } );
+  test.execute( PeekAt { 8, "" } );
+  test.execute( Pop { 5 } );
+  test.execute( Peek { "jkl" } );
+  test.execute( Push { "mnopq" } );
+  test.execute( BytesPushed { 17 } );
+  test.execute( Peek { "jklmnopq" } );
+  test.execute( Close {} );
+  test.execute( ReadAll { "jklmnopq" } );
+  test.execute( IsFinished { true } );
+}
+
+void pop_across_pushes( ByteStream::Storage storage )
+{
+  ByteStreamTestHarness test { "pop-across-pushes/" + storage_name( storage ), 4096, storage };
+
+  const string big( 1000, 'x' );
+  test.execute( Push { big } );
+  test.execute( Push { "hello" } );
+  test.execute( Push { big } );
+  test.execute( BytesBuffered { 2005 } );
+  test.execute( Pop { 998 } );
+  test.execute( Peek { "xx" + string( "hello" ) + big } );
+  test.execute( PeekAll { "xx" + string( "hello" ) + big } );
+  test.execute( Pop { 4 } );
+  test.execute( Peek { "llo" + big } );
+  test.execute( Pop { 1003 } );
+  test.execute( BufferEmpty { true } );
+  test.execute( PeekAll { "" } );
+  test.execute( BytesPopped { 2005 } );
+  test.execute( AvailableCapacity { 4096 } );
+}
+
+void reserve_commit( ByteStream::Storage storage )
+{
+  ByteStreamTestHarness test { "reserve-commit/" + storage_name( storage ), 8, storage };
+
+  test.execute( ReserveCommit { 3, "abc" } );
+  test.execute( BytesPushed { 3 } );
+  test.execute( Peek { "abc" } );
+  test.execute( Pop { 2 } );
+  test.execute( Push { "defgh" } );
+  test.execute( ReserveCommit { 100, "ij" } );
+  test.execute( BytesPushed { 10 } );
+  test.execute( AvailableCapacity { 0 } );
+  test.execute( Peek { "cdefghij" } );
+  test.execute( Pop { 7 } );
+  test.execute( ReserveCommit { 5, "klmno" } );
+  test.execute( PeekAll { "jklmno" } );
+  test.execute( ReserveCommit { 0, "" } );
+  test.execute( BytesBuffered { 6 } );
+}
+
+void chunk_boundaries()
+{
+  ByteStreamTestHarness test { "chunk-boundaries", 4096, ByteStream::Storage::Chunked };
+
+  const string first( 600, 'a' );
+  const string second( 600, 'b' );
+  test.execute( Push { first } );
+  test.execute( Push { second } );
+  test.execute( PeekOnce { first } );
+  test.execute( PeekAt { 100, first.substr( 100 ) } );
+  test.execute( PeekAt { 600, second } );
+  test.execute( Pop { 100 } );
+  test.execute( PeekOnce { first.substr( 100 ) } );
+  test.execute( Pop { 500 } );
+  test.execute( PeekOnce { second } );
+}
+
+void chunk_offsets()
+{
+  ByteStreamTestHarness test { "chunk-offsets", 1 << 20, ByteStream::Storage::Chunked };
+
+  /* Peeking by offset lands in the right chunk wherever the front chunk was partly popped */
+  string all;
+  for ( char c = 'a'; c <= 'z'; ++c ) {
+    const string chunk( 600 + c, c );
+    test.execute( Push { chunk } );
+    all += chunk;
+  }
+  uint64_t popped = 0;
+  for ( const uint64_t pop : { 0UL, 1UL, 700UL, 2000UL, 3333UL } ) {
+    test.execute( Pop { pop } );
+    popped += pop;
+    for ( uint64_t offset = 0; popped + offset < all.size(); offset += 997 ) {
+      const uint64_t index = popped + offset;
+      const uint64_t chunk_end = all.find_first_not_of( all[index], index );
+      test.execute( PeekAt { offset, all.substr( index, chunk_end - index ) } );
+    }
+  }
+}
+
+void chunk_reserve()
+{
+  ByteStreamTestHarness test { "chunk-reserve", 1 << 20, ByteStream::Storage::Chunked };
+
+  /* A reserve gets a block sized to the request (up to the pool's largest block). Later reserves fill the rest
+   * of the newest block in place, so small reads end up contiguous, unless too little of it is left */
+  test.execute( ReserveCommit { 1000, "abc" } );
+  test.execute( ReserveSize { 2000, 997 } );
+  test.execute( ReserveCommit { 50, string( 50, 'd' ) } );
+  test.execute( PeekOnce { "abc" + string( 50, 'd' ) } );
+  test.execute( ReserveCommit { 947, string( 947, 'e' ) } );
+  test.execute( PeekOnce { "abc" + string( 50, 'd' ) + string( 947, 'e' ) } );
+  test.execute( ReserveCommit { 600, string( 600, 'f' ) } );
+  test.execute( ReserveSize { 1000, 1000 } );
+  test.execute( Push { "ghi" } );
+  test.execute( PeekAt { 1000, string( 600, 'f' ) } );
+  test.execute( PeekAt { 1600, "ghi" } );
+  test.execute( ReserveSize { 1 << 20, Buffer::kMaxPooledSize } );
+  test.execute( Pop { 1100 } );
+  test.execute( ReadAll { string( 500, 'f' ) + "ghi" } );
+}
+
+void chunk_lending()
+{
+  ByteStreamTestHarness test { "chunk-lending", 4096, ByteStream::Storage::Chunked };
+
+  /* Only a run of bytes that is exactly one whole chunk can be lent out, and it comes back unchanged */
+  const string first( 600, 'a' );
+  const string second( 700, 'b' );
+  test.execute( Push { first } );
+  test.execute( Push { second } );
+  test.execute( LendChunk { 0, 600, first } );
+  test.execute( LendChunk { 600, 700, second } );
+  test.execute( LendChunk { 0, 599, nullopt } );
+  test.execute( LendChunk { 1, 599, nullopt } );
+  test.execute( LendChunk { 0, 1300, nullopt } );
+  test.execute( PeekAll { first + second } );
+  test.execute( Pop { 100 } );
+  test.execute( LendChunk { 0, 500, nullopt } );
+  test.execute( LendChunk { 500, 700, second } );
+  test.execute( PeekAt { 500, second } );
+
+  /* A borrower that throws still gives the chunk back */
+  test.execute( LendChunkAndThrow { 500, 700 } );
+  test.execute( PeekAt { 500, second } );
+  test.execute( ReadAll { first.substr( 100 ) + second } );
+}
+
+void mirrored_wraparound()
+{
+  ByteStreamTestHarness test { "mirrored-wraparound", 4096, ByteStream::Storage::Mirrored };
+
+  const string first( 3000, 'a' );
+  const string second = string( 1096, 'b' ) + string( 1000, 'c' );
+  test.execute( Push { first } );
+  test.execute( Pop { 3000 } );
+  test.execute( Push { second } );
+  test.execute( PeekOnce { second } );
+  test.execute( PeekAt { 1000, second.substr( 1000 ) } );
+  test.execute( Pop { 96 } );
+  test.execute( ReserveCommit { 2000, string( 2000, 'd' ) } );
+  test.execute( PeekOnce { second.substr( 96 ) + string( 2000, 'd' ) } );
+  test.execute( AvailableCapacity { 96 } );
+}
+
+void spilled_roundtrip()
+{
+  /* Several times the hot window goes through a buffer bigger than it, so bytes are written out to the file,
+   * paged back in and discarded, both for pushes and for reserve/commit */
+  constexpr uint64_t capacity = 6 << 20;
+  constexpr uint64_t part = 3 << 20;
+  ByteStreamTestHarness test { "spilled-roundtrip", capacity, ByteStream::Storage::Spilled };
+
+  string previous( part - 5, 'a' );
+  test.execute( Push { previous } );
+  for ( char c = 'b'; c < 'n'; ++c ) {
+    const string next( part, c );
+    if ( c % 2 ) {
+      test.execute( Push { next } );
+    } else {
+      test.execute( ReserveCommit { part, next } );
+    }
+    test.execute( BytesBuffered { previous.size() + part } );
+    test.execute( PeekOnce { previous + next } );
+    test.execute( Pop { previous.size() } );
+    previous = next;
+  }
+  test.execute( Close {} );
+  test.execute( ReadAll { previous } );
+  test.execute( IsFinished { true } );
+}
+
+int main()
+{
+  try {
+    for ( const auto storage : { ByteStream::Storage::Ring,
+                                 ByteStream::Storage::Chunked,
+                                 ByteStream::Storage::Mirrored,
+                                 ByteStream::Storage::Spilled } ) {
+      wraparound( storage );
+      pop_across_pushes( storage );
+      reserve_commit( storage );
+    }
+    chunk_boundaries();
+    chunk_offsets();
+    chunk_reserve();
+    chunk_lending();
+    mirrored_wraparound();
+    spilled_roundtrip();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
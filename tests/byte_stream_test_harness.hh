@@ -4,6 +4,8 @@
 #include "common.hh"
 #include "helpers.hh"
 
+#include <optional>
+#include <stdexcept>
 #include <utility>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
@@ -12,6 +14,21 @@ static_assert( sizeof( Reader ) == sizeof( ByteStream ),
 static_assert( sizeof( Writer ) == sizeof( ByteStream ),
                "Please add member variables to the ByteStream base, not the ByteStream Writer." );
 
+inline std::string storage_name( ByteStream::Storage storage )
+{
+  switch ( storage ) {
+    case ByteStream::Storage::Ring:
+      return "Ring";
+    case ByteStream::Storage::Chunked:
+      return "Chunked";
+    case ByteStream::Storage::Mirrored:
+      return "Mirrored";
+    case ByteStream::Storage::Spilled:
+      return "Spilled";
+  }
+  return "unknown";
+}
+
 class ByteStreamTestHarness : public TestHarness<ByteStream>
 {
 public:
@@ -19,6 +36,12 @@ public:
     : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
   {}
 
+  ByteStreamTestHarness( std::string test_name, uint64_t capacity, ByteStream::Storage storage )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ) + ", storage=" + storage_name( storage ),
+                   ByteStream { capacity, storage } )
+  {}
+
   size_t peek_size() { return object().reader().peek().size(); }
 };
 
@@ -34,6 +57,60 @@ struct Push : public Action<ByteStream>
   constexpr std::string obj() const override { return "Writer"; }
 };
 
+struct ReserveCommit : public Action<ByteStream>
+{
+  uint64_t reserve_len_;
+  std::string data_;
+
+  ReserveCommit( uint64_t reserve_len, std::string data ) : reserve_len_( reserve_len ), data_( move( data ) ) {}
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( reserve_len_ ) + " ), write \"" + pretty_print( data_ )
+           + "\" and commit";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    uint64_t written = 0;
+    for ( const auto region : bs.writer().reserve( reserve_len_ ) ) {
+      const uint64_t len = std::min( region.size(), data_.size() - written );
+      data_.copy( region.data(), len, written );
+      written += len;
+    }
+    if ( written != data_.size() ) {
+      throw ExpectationViolation { "reserve() should have returned room for " + std::to_string( data_.size() )
+                                   + " bytes, but only gave " + std::to_string( written ) };
+    }
+    bs.writer().commit( written );
+  }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
+struct ReserveSize : public Action<ByteStream>
+{
+  uint64_t reserve_len_;
+  uint64_t size_;
+
+  ReserveSize( uint64_t reserve_len, uint64_t size ) : reserve_len_( reserve_len ), size_( size ) {}
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( reserve_len_ ) + " ) gives room for " + std::to_string( size_ )
+           + " bytes, and commit none";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    uint64_t size = 0;
+    for ( const auto region : bs.writer().reserve( reserve_len_ ) ) {
+      size += region.size();
+    }
+    if ( size != size_ ) {
+      throw ExpectationViolation { "reserve() should have returned room for " + std::to_string( size_ )
+                                   + " bytes, but gave " + std::to_string( size ) };
+    }
+    bs.writer().commit( 0 );
+  }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
 struct Close : public Action<ByteStream>
 {
   std::string description() const override { return "close"; }
@@ -57,6 +134,59 @@ struct Pop : public Action<ByteStream>
   constexpr std::string obj() const override { return "Reader"; }
 };
 
+struct LendChunk : public Action<ByteStream>
+{
+  uint64_t offset_;
+  uint64_t len_;
+  std::optional<std::string> chunk_;
+
+  LendChunk( uint64_t offset, uint64_t len, std::optional<std::string> chunk )
+    : offset_( offset ), len_( len ), chunk_( move( chunk ) )
+  {}
+  std::string description() const override
+  {
+    return "lend_chunk( " + std::to_string( offset_ ) + ", " + std::to_string( len_ ) + " ) lends "
+           + ( chunk_.has_value() ? "\"" + pretty_print( *chunk_ ) + "\", which comes back" : "nothing" );
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    std::string lent;
+    const Reader::ChunkLoan loan = bs.reader().lend_chunk( offset_, len_, lent );
+    const std::optional<std::string> chunk = loan ? std::optional { lent } : std::nullopt;
+    if ( chunk != chunk_ ) {
+      throw ExpectationViolation { "lend_chunk() should have lent "
+                                   + ( chunk_.has_value() ? "\"" + pretty_print( *chunk_ ) + "\"" : "nothing" )
+                                   + ", but lent "
+                                   + ( chunk.has_value() ? "\"" + pretty_print( *chunk ) + "\"" : "nothing" ) };
+    }
+  }
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
+struct LendChunkAndThrow : public Action<ByteStream>
+{
+  uint64_t offset_;
+  uint64_t len_;
+
+  LendChunkAndThrow( uint64_t offset, uint64_t len ) : offset_( offset ), len_( len ) {}
+  std::string description() const override
+  {
+    return "lend_chunk( " + std::to_string( offset_ ) + ", " + std::to_string( len_ )
+           + " ), then throw while it is lent";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    try {
+      std::string lent;
+      const Reader::ChunkLoan loan = bs.reader().lend_chunk( offset_, len_, lent );
+      throw std::runtime_error( "borrower failed" );
+    } catch ( const std::runtime_error& ) {
+      return;
+    }
+  }
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
 /* expectations */
 
 struct Peek : public Expectation<ByteStream>
@@ -119,6 +249,56 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekAt : public Expectation<ByteStream>
+{
+  uint64_t offset_;
+  std::string output_;
+
+  PeekAt( uint64_t offset, std::string output ) : offset_( offset ), output_( move( output ) ) {}
+
+  std::string description() const override
+  {
+    return "peek( " + std::to_string( offset_ ) + " ) gives exactly \"" + pretty_print( output_ ) + "\"";
+  }
+
+  void execute( const ByteStream& bs ) const override
+  {
+    auto peeked = bs.reader().peek( offset_ );
+    if ( peeked != output_ ) {
+      throw ExpectationViolation { "peek( " + std::to_string( offset_ ) + " ) should have returned \""
+                                   + pretty_print( output_ ) + "\", but instead returned \""
+                                   + pretty_print( peeked ) + "\"" };
+    }
+  }
+
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
+struct PeekAll : public Peek
+{
+  using Peek::Peek;
+
+  std::string description() const override
+  {
+    return "peek_all() regions concatenate to \"" + pretty_print( output_ ) + "\"";
+  }
+
+  void execute( const ByteStream& bs ) const override
+  {
+    std::string got;
+    for ( const auto region : bs.reader().peek_all() ) {
+      if ( region.empty() ) {
+        throw ExpectationViolation { "peek_all() returned an empty region" };
+      }
+      got += region;
+    }
+    if ( got != output_ ) {
+      throw ExpectationViolation { "peek_all() should have returned \"" + pretty_print( output_ )
+                                   + "\", but instead returned \"" + pretty_print( got ) + "\"" };
+    }
+  }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -80,6 +80,18 @@ string to_string( const TCPSenderMessage& msg )
   if ( msg.SYN ) {
     o << " +SYN";
   }
+  if ( msg.SACK_permitted ) {
+    o << " +SACK_PERM";
+  }
+  if ( msg.window_scale.has_value() ) {
+    o << " WS=" << static_cast<int>( *msg.window_scale );
+  }
+  if ( msg.max_segment_size.has_value() ) {
+    o << " MSS=" << *msg.max_segment_size;
+  }
+  if ( msg.timestamp.has_value() ) {
+    o << " TSval=" << *msg.timestamp;
+  }
   if ( not msg.payload.empty() ) {
     o << " payload=\"" << pretty_print( msg.payload ) << "\"";
   }
@@ -0,0 +1,243 @@
+#include "benchmark_common.hh"
+#include "congestion_control.hh"
+#include "tcp_config.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// A TCPSender and TCPReceiver connected through a simulated bottleneck: segments wait in a drop-tail queue,
+// leave it at the link's rate, and arrive after the one-way delay; acks come back after the same delay on an
+// uncongested path. Simulated time advances in 1 ms steps, the granularity of TCPSender::tick().
+namespace {
+constexpr uint64_t HEADER_BYTES = 40; // IPv4 + TCP headers, counted against the link's rate and the queue
+
+struct Scenario
+{
+  string name;
+  uint64_t rate_kbit_per_s; // bottleneck rate
+  uint64_t rtt_ms;          // base round-trip time (twice the one-way delay), without queueing
+  uint64_t queue_bytes;     // bottleneck queue limit
+  uint64_t buffer_bytes {}; // send and receive capacity of the endpoints (0: TCPConfig's defaults)
+
+  uint64_t bdp_bytes() const { return rate_kbit_per_s * rtt_ms / 8; }
+};
+
+struct Result
+{
+  Scenario scenario;
+  string algorithm;
+  bool window_scaling;           // whether the endpoints negotiated RFC 7323 window scaling
+  double seconds;                // simulated time
+  uint64_t delivered_bytes;      // bytes that came out of the receiver's stream
+  uint64_t segments_sent;        // segments that entered the bottleneck queue (or were dropped at it)
+  uint64_t segments_dropped;     // segments that found the queue full
+  double total_queue_delay_ms;   // summed over the segments that went through the queue
+  uint64_t max_queue_delay_ms;   // worst wait in the queue
+  uint64_t forwarded_segments;   // segments that went through the queue
+
+  double goodput_mbit_per_s() const { return 8 * static_cast<double>( delivered_bytes ) / seconds / 1e6; }
+  double utilization() const
+  {
+    return goodput_mbit_per_s() * 1000 / static_cast<double>( scenario.rate_kbit_per_s );
+  }
+  double mean_queue_delay_ms() const
+  {
+    return forwarded_segments ? total_queue_delay_ms / static_cast<double>( forwarded_segments ) : 0;
+  }
+  double loss_percent() const
+  {
+    return segments_sent ? 100.0 * static_cast<double>( segments_dropped ) / static_cast<double>( segments_sent )
+                         : 0;
+  }
+};
+
+Result run( const Scenario& scenario,
+            CongestionControl::Algorithm algorithm,
+            const string& name,
+            bool window_scaling,
+            uint64_t ms )
+{
+  TCPConfig cfg;
+  cfg.congestion_control = algorithm;
+  cfg.window_scaling = window_scaling;
+  if ( scenario.buffer_bytes ) {
+    cfg.send_capacity = cfg.recv_capacity = scenario.buffer_bytes;
+  }
+  const optional<uint8_t> window_scale = window_scaling ? optional { cfg.window_scale() } : nullopt;
+  TCPSender sender { ByteStream { cfg.send_capacity }, cfg };
+  TCPReceiver receiver { Reassembler { ByteStream { cfg.recv_capacity } }, window_scale };
+  const string fill( cfg.send_capacity, 'x' );
+
+  const uint64_t one_way_ms = scenario.rtt_ms / 2;
+  const double bytes_per_ms = static_cast<double>( scenario.rate_kbit_per_s ) / 8;
+
+  struct Queued
+  {
+    TCPSenderMessage msg;
+    uint64_t enqueued_ms;
+  };
+  deque<Queued> queue;
+  uint64_t queued_bytes = 0;
+  double link_credit = 0;
+  deque<pair<uint64_t, TCPSenderMessage>> in_transit;
+  deque<pair<uint64_t, TCPReceiverMessage>> acks_in_transit;
+
+  Result result { scenario, name, window_scaling, static_cast<double>( ms ) / 1000, 0, 0, 0, 0, 0, 0 };
+  uint64_t now = 0;
+  bool syn_ack_sent = false;
+  bool syn_acked = false;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    ++result.segments_sent;
+    const uint64_t size = msg.payload.size() + HEADER_BYTES;
+    if ( queued_bytes + size > scenario.queue_bytes ) {
+      ++result.segments_dropped;
+      return;
+    }
+    queued_bytes += size;
+    queue.push_back( { msg, now } );
+  };
+
+  for ( ; now < ms; ++now ) {
+    while ( not acks_in_transit.empty() and acks_in_transit.front().first <= now ) {
+      sender.receive( acks_in_transit.front().second );
+      acks_in_transit.pop_front();
+      if ( not syn_acked ) {
+        // the first ack stands for the peer's SYN, which offers the receiver's shift (if it scales)
+        sender.set_peer_window_scale( window_scale );
+        syn_acked = true;
+      }
+      // as TCPPeer does: a fast link delivers many acks per step, and cwnd only grows on those that find it full
+      sender.push( transmit );
+    }
+
+    while ( not in_transit.empty() and in_transit.front().first <= now ) {
+      receiver.receive( move( in_transit.front().second ) );
+      in_transit.pop_front();
+      acks_in_transit.emplace_back( now + one_way_ms, receiver.send( not syn_ack_sent ) );
+      syn_ack_sent = true;
+    }
+    result.delivered_bytes += receiver.reader().bytes_buffered();
+    receiver.reader().pop( receiver.reader().bytes_buffered() );
+
+    // the link sends at its rate while there is a queue; an idle link doesn't bank credit for a later burst
+    link_credit += bytes_per_ms;
+    while ( not queue.empty()
+            and link_credit >= static_cast<double>( queue.front().msg.payload.size() + HEADER_BYTES ) ) {
+      Queued& head = queue.front();
+      const uint64_t size = head.msg.payload.size() + HEADER_BYTES;
+      link_credit -= static_cast<double>( size );
+      queued_bytes -= size;
+      const uint64_t waited = now - head.enqueued_ms;
+      result.total_queue_delay_ms += static_cast<double>( waited );
+      result.max_queue_delay_ms = max( result.max_queue_delay_ms, waited );
+      ++result.forwarded_segments;
+      in_transit.emplace_back( now + one_way_ms, move( head.msg ) );
+      queue.pop_front();
+    }
+    if ( queue.empty() ) {
+      link_credit = min( link_credit, bytes_per_ms );
+    }
+
+    // the application always has more to send
+    sender.writer().push( fill.substr( 0, sender.writer().available_capacity() ) );
+    sender.push( transmit );
+    sender.tick( 1, transmit );
+  }
+
+  return result;
+}
+
+void print_table_row( const Result& r )
+{
+  cout << left << setw( 28 ) << r.scenario.name << setw( 10 ) << r.algorithm << setw( 5 )
+       << ( r.window_scaling ? "on" : "off" ) << right << fixed << setprecision( 2 ) << setw( 10 )
+       << r.goodput_mbit_per_s() << setw( 8 ) << setprecision( 1 ) << 100 * r.utilization() << "%"
+       << setw( 10 ) << r.mean_queue_delay_ms() << setw( 8 ) << r.max_queue_delay_ms << setw( 8 )
+       << setprecision( 2 ) << r.loss_percent() << "%\n";
+}
+
+benchmark::Fields fields( const Result& r )
+{
+  return { benchmark::field( "scenario", r.scenario.name ),
+           benchmark::field( "rate_kbit_per_s", r.scenario.rate_kbit_per_s ),
+           benchmark::field( "rtt_ms", r.scenario.rtt_ms ),
+           benchmark::field( "queue_bytes", r.scenario.queue_bytes ),
+           benchmark::field( "buffer_bytes", r.scenario.buffer_bytes ),
+           benchmark::field( "algorithm", r.algorithm ),
+           benchmark::field( "window_scaling", r.window_scaling ),
+           benchmark::field( "goodput_mbit_per_s", r.goodput_mbit_per_s() ),
+           benchmark::field( "mean_queue_delay_ms", r.mean_queue_delay_ms() ),
+           benchmark::field( "max_queue_delay_ms", r.max_queue_delay_ms ),
+           benchmark::field( "loss_percent", r.loss_percent() ) };
+}
+
+void program_body( span<char*> args )
+{
+  const benchmark::Options options
+    = benchmark::parse_options( args, { "seconds", 60, "Simulate <n> seconds of each flow" } );
+  const uint64_t ms = options.size * 1000;
+
+  // the receiver's window is more than the path holds in each scenario, so it's up to congestion control to keep
+  // the queue from overflowing or filling up
+  const vector<Scenario> scenarios { { "10Mbit 20ms q=1/2BDP", 10'000, 20, 12'500 },
+                                     { "10Mbit 20ms q=2BDP", 10'000, 20, 50'000 },
+                                     { "2Mbit 40ms q=1BDP", 2'000, 40, 10'000 },
+                                     { "2Mbit 40ms q=4BDP", 2'000, 40, 40'000 },
+                                     // long fat pipes: without window scaling the 64 KB advertised window,
+                                     // not the path, caps the flow at 64 KB per round trip
+                                     { "25Mbit 50ms q=1BDP 2MB", 25'000, 50, 156'250, 2'000'000 },
+                                     { "100Mbit 50ms q=1BDP 8MB", 100'000, 50, 625'000, 8'000'000 } };
+  const vector<pair<string, CongestionControl::Algorithm>> algorithms {
+    { "none", CongestionControl::Algorithm::None },
+    { "NewReno", CongestionControl::Algorithm::NewReno },
+    { "CUBIC", CongestionControl::Algorithm::Cubic } };
+
+  cout << left << setw( 28 ) << "scenario" << setw( 10 ) << "cc" << setw( 5 ) << "ws" << right << setw( 10 )
+       << "Mbit/s" << setw( 9 ) << "util" << setw( 10 ) << "qdelay" << setw( 8 ) << "max" << setw( 9 ) << "loss"
+       << "\n";
+
+  vector<Result> results;
+  for ( const Scenario& scenario : scenarios ) {
+    for ( const auto& [name, algorithm] : algorithms ) {
+      // scaling only changes anything once the buffers are bigger than an unscaled window can advertise
+      for ( const bool window_scaling : { false, true } ) {
+        if ( window_scaling and scenario.buffer_bytes <= UINT16_MAX ) {
+          continue;
+        }
+        results.push_back( run( scenario, algorithm, name, window_scaling, ms ) );
+        print_table_row( results.back() );
+      }
+    }
+  }
+
+  benchmark::write_results(
+    options, "congestion_control", { benchmark::field( "simulated_ms", ms ) }, results, fields );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    program_body( span( argv, argc ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
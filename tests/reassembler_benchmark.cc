@@ -0,0 +1,242 @@
+#include "benchmark_common.hh"
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+struct Segment
+{
+  uint64_t first_index;
+  uint64_t length;
+};
+
+// A traffic pattern: the segments that deliver one capacity-sized block of the stream, in arrival order.
+// Every segment of a block fits in the Reassembler's window, because the blocks before it are complete.
+struct Scenario
+{
+  string name;
+  function<vector<Segment>( uint64_t block_start, uint64_t block_size, default_random_engine& rd )> generate;
+};
+
+constexpr uint64_t kSegmentSize = 1460;
+
+// The block cut into `segment_size`-byte segments, in order
+vector<Segment> cut( uint64_t block_start, uint64_t block_size, uint64_t segment_size )
+{
+  vector<Segment> segments;
+  for ( uint64_t i = 0; i < block_size; i += segment_size ) {
+    segments.push_back( { block_start + i, min( segment_size, block_size - i ) } );
+  }
+  return segments;
+}
+
+// Each segment arrives up to `displacement` places later than it was sent
+vector<Segment> reorder( uint64_t block_start, uint64_t block_size, default_random_engine& rd, size_t displacement )
+{
+  vector<Segment> segments = cut( block_start, block_size, kSegmentSize );
+  vector<pair<size_t, Segment>> keyed;
+  uniform_int_distribution<size_t> delay { 0, displacement };
+  for ( size_t i = 0; i < segments.size(); ++i ) {
+    keyed.emplace_back( i + delay( rd ), segments[i] );
+  }
+  stable_sort( keyed.begin(), keyed.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+  for ( size_t i = 0; i < keyed.size(); ++i ) {
+    segments[i] = keyed[i].second;
+  }
+  return segments;
+}
+
+const vector<Scenario>& scenarios()
+{
+  static const vector<Scenario> all {
+    { "in-order", []( uint64_t start, uint64_t size, auto& ) { return cut( start, size, kSegmentSize ); } },
+    { "reorder-d4", []( uint64_t start, uint64_t size, auto& rd ) { return reorder( start, size, rd, 4 ); } },
+    { "reorder-d64", []( uint64_t start, uint64_t size, auto& rd ) { return reorder( start, size, rd, 64 ); } },
+    { "reverse",
+      []( uint64_t start, uint64_t size, auto& ) {
+        vector<Segment> segments = cut( start, size, kSegmentSize );
+        reverse( segments.begin(), segments.end() );
+        return segments;
+      } },
+    // each segment is (re)transmitted four times, each copy widened by up to a segment on either side
+    { "duplicates-x4",
+      []( uint64_t start, uint64_t size, auto& rd ) {
+        vector<Segment> segments;
+        uniform_int_distribution<uint64_t> widen { 0, kSegmentSize };
+        for ( const Segment& s : cut( start, size, kSegmentSize ) ) {
+          for ( int copy = 0; copy < 4; ++copy ) {
+            const uint64_t first = max( start, s.first_index - min( s.first_index, widen( rd ) ) );
+            const uint64_t last = min( start + size, s.first_index + s.length + widen( rd ) );
+            segments.push_back( { first, last - first } );
+          }
+        }
+        shuffle( segments.begin(), segments.end(), rd );
+        return segments;
+      } },
+    { "1-byte-random",
+      []( uint64_t start, uint64_t size, auto& rd ) {
+        vector<Segment> segments = cut( start, size, 1 );
+        shuffle( segments.begin(), segments.end(), rd );
+        return segments;
+      } },
+    // every other byte first, leaving a 1-byte hole between each; then the holes, last one first,
+    // so nothing can be pushed until the very last byte of the block arrives
+    { "alternating-holes",
+      []( uint64_t start, uint64_t size, auto& ) {
+        vector<Segment> segments;
+        for ( uint64_t i = 1; i < size; i += 2 ) {
+          segments.push_back( { start + i, 1 } );
+        }
+        for ( uint64_t i = ( size - 1 ) / 2 * 2 + 2; i >= 2; i -= 2 ) {
+          segments.push_back( { start + i - 2, 1 } );
+        }
+        return segments;
+      } },
+  };
+  return all;
+}
+
+struct Result
+{
+  string scenario;
+  uint64_t capacity;
+  uint64_t bytes;          // length of the stream
+  uint64_t segments;       // number of insert() calls
+  uint64_t bytes_inserted; // total payload of those calls (counting duplicates)
+  double seconds;
+  uint64_t peak_pending;   // largest count_bytes_pending() seen after an insert()
+  int64_t peak_heap;       // most heap bytes in use (beyond those before the run) at any point
+  uint64_t allocations;    // heap allocations made during the run
+
+  double nanoseconds_per_byte() const { return seconds * 1e9 / static_cast<double>( bytes ); }
+  double gigabits_per_second() const { return 8 * static_cast<double>( bytes ) / seconds / 1e9; }
+};
+
+Result run( const Scenario& scenario, const string& data, uint64_t capacity )
+{
+  // Generate the arrival order, and each segment's payload, before timing
+  default_random_engine rd { 1370 };
+  vector<Segment> segments;
+  for ( uint64_t start = 0; start < data.size(); start += capacity ) {
+    const vector<Segment> block = scenario.generate( start, min( capacity, data.size() - start ), rd );
+    segments.insert( segments.end(), block.begin(), block.end() );
+  }
+  vector<string> payloads;
+  uint64_t bytes_inserted = 0;
+  for ( const Segment& s : segments ) {
+    payloads.emplace_back( data.substr( s.first_index, s.length ) );
+    bytes_inserted += s.length;
+  }
+
+  Reassembler reassembler { ByteStream { capacity } };
+  string output_data;
+  output_data.reserve( data.size() );
+  uint64_t peak_pending = 0;
+
+  const int64_t heap_before = benchmark::heap_bytes.load();
+  benchmark::peak_heap_bytes = heap_before;
+  const uint64_t allocations_before = benchmark::allocation_count.load();
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < segments.size(); ++i ) {
+    const Segment& s = segments[i];
+    reassembler.insert( s.first_index, move( payloads[i] ), s.first_index + s.length == data.size() );
+    peak_pending = max( peak_pending, reassembler.count_bytes_pending() );
+
+    while ( reassembler.reader().bytes_buffered() ) {
+      const string_view peeked = reassembler.reader().peek();
+      output_data += peeked;
+      reassembler.reader().pop( peeked.size() );
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  const uint64_t allocations = benchmark::allocation_count.load() - allocations_before;
+  const int64_t peak_heap = benchmark::peak_heap_bytes.load() - heap_before;
+
+  if ( not reassembler.reader().is_finished() or output_data != data ) {
+    throw runtime_error( "Reassembler did not reproduce the stream (" + scenario.name + ")" );
+  }
+
+  return { scenario.name,
+           capacity,
+           data.size(),
+           segments.size(),
+           bytes_inserted,
+           duration_cast<duration<double>>( stop_time - start_time ).count(),
+           peak_pending,
+           peak_heap,
+           allocations };
+}
+
+void print_table_row( const Result& r )
+{
+  cout << left << setw( 20 ) << r.scenario << right << setw( 10 ) << r.capacity << setw( 10 ) << r.segments
+       << fixed << setprecision( 2 ) << setw( 10 ) << r.nanoseconds_per_byte() << setw( 10 )
+       << r.gigabits_per_second() << setw( 14 ) << r.peak_pending << setw( 12 ) << r.peak_heap << setw( 10 )
+       << r.allocations << "\n";
+}
+
+benchmark::Fields fields( const Result& r )
+{
+  return { benchmark::field( "scenario", r.scenario ),
+           benchmark::field( "capacity", r.capacity ),
+           benchmark::field( "bytes", r.bytes ),
+           benchmark::field( "segments", r.segments ),
+           benchmark::field( "bytes_inserted", r.bytes_inserted ),
+           benchmark::field( "ns_per_byte", r.nanoseconds_per_byte() ),
+           benchmark::field( "gbit_per_s", r.gigabits_per_second() ),
+           benchmark::field( "peak_pending", r.peak_pending ),
+           benchmark::field( "peak_heap_bytes", r.peak_heap ),
+           benchmark::field( "allocations", r.allocations ) };
+}
+
+void program_body( span<char*> args )
+{
+  const benchmark::Options options = benchmark::parse_options(
+    args, { "bytes", 4'000'000, "Length of the stream reassembled in each configuration" } );
+
+  const string data = benchmark::make_data( options.size, 6163 );
+
+  cout << left << setw( 20 ) << "scenario" << right << setw( 10 ) << "capacity" << setw( 10 ) << "segments"
+       << setw( 10 ) << "ns/byte" << setw( 10 ) << "Gbit/s" << setw( 14 ) << "peak pending" << setw( 12 )
+       << "peak heap" << setw( 10 ) << "allocs"
+       << "\n";
+
+  vector<Result> results;
+  for ( const uint64_t capacity : { 65536UL, 1048576UL } ) {
+    for ( const Scenario& scenario : scenarios() ) {
+      results.push_back( run( scenario, data, capacity ) );
+      print_table_row( results.back() );
+    }
+  }
+
+  benchmark::write_results( options, "reassembler", {}, results, fields );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    program_body( span( argv, argc ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -248,6 +248,98 @@ int main()
 
       test.execute( IsFinished( true ) );
     }
+
+    {
+      ReassemblerTestHarness test { "bytes beyond capacity are counted", 2 };
+
+      test.execute( Insert { "abc", 0 } );
+      test.execute( BytesBeyondWindow( 1 ) );
+      test.execute( Insert { "z", 5 } );
+      test.execute( BytesBeyondWindow( 2 ) );
+      test.execute( ReadAll( "ab" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "memory is the blocks that hold bytes", 65000 };
+
+      /* 37 window blocks of 1792 bytes, each a 2 KiB pool block while it holds any */
+      test.execute( Insert { "abcd", 0 } );
+      test.execute( MemoryUsage( 0 ) );
+      test.execute( Insert { "f", 5 } );
+      test.execute( MemoryUsage( 2048 + 37 * 8 ) );
+      test.execute( Insert { "x", 1792 * 20 } );
+      test.execute( MemoryUsage( 2 * 2048 + 37 * 8 ) );
+      test.execute( Insert { "e", 4 } );
+      test.execute( BytesPushed( 6 ) );
+      test.execute( MemoryUsage( 2048 + 37 * 8 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "memory limit bounds memory", 1'000'000, 12'000, Reassembler::DropPolicy::Newest };
+
+      /* The table of 559 blocks leaves room for 3 blocks under the limit, however few bytes each one holds */
+      for ( uint64_t block = 1; block <= 10; ++block ) {
+        test.execute( Insert { "x", block * 1792 } );
+      }
+      test.execute( BytesPending( 3 ) );
+      test.execute( BytesOverLimit( 7 ) );
+      test.execute( MemoryUsage( 3 * 2048 + 559 * 8 ) );
+      test.execute( Insert { "yz", 1792 + 1 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( MemoryUsage( 3 * 2048 + 559 * 8 ) );
+    }
+
+    {
+      ReassemblerTestHarness test {
+        "memory limit evicts farthest blocks", 1'000'000, 12'000, Reassembler::DropPolicy::Farthest };
+
+      for ( const uint64_t block : { 5, 6, 7, 2 } ) {
+        test.execute( Insert { "x", block * 1792 } );
+      }
+      test.execute( BytesPending( 3 ) );
+      test.execute( BytesEvicted( 1 ) );
+      test.execute( BytesOverLimit( 0 ) );
+      test.execute( MemoryUsage( 3 * 2048 + 559 * 8 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "memory limit drops newest", 100, 4, Reassembler::DropPolicy::Newest };
+
+      test.execute( Insert { "bcd", 1 } );
+      test.execute( BytesPending( 3 ) );
+      test.execute( Insert { "fgh", 5 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesOverLimit( 2 ) );
+      test.execute( Insert { "cdef", 2 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesOverLimit( 3 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( BytesPushed( 4 ) );
+      test.execute( BytesPending( 1 ) );
+      test.execute( Insert { "efgh", 4 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcdefgh" ) );
+      test.execute( BytesEvicted( 0 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "memory limit evicts farthest", 100, 4, Reassembler::DropPolicy::Farthest };
+
+      test.execute( Insert { "xy", 10 } );
+      test.execute( Insert { "bcd", 1 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesEvicted( 1 ) );
+      test.execute( Insert { "e", 4 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesEvicted( 2 ) );
+      test.execute( Insert { "ghijklm", 6 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesOverLimit( 7 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( BytesPushed( 5 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcde" ) );
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -130,6 +130,22 @@ int main()
       test.execute( ReadAll( "" ) );
       test.execute( IsFinished { true } );
     }
+
+    {
+      /* Filling the gap releases more bytes than one pool block, which is all Chunked reserves at once */
+      ReassemblerTestHarness test { "gap filled into chunked storage", 200'000, ByteStream::Storage::Chunked };
+
+      const string tail( 150'000, 'y' );
+      test.execute( Insert { tail, 1 }.is_last() );
+      test.execute( BytesPushed( 0 ) );
+      test.execute( BytesPending( 150'000 ) );
+
+      test.execute( Insert { "x", 0 } );
+      test.execute( BytesPushed( 150'001 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "x" + tail ) );
+      test.execute( IsFinished { true } );
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "byte_stream_test_harness.hh"
 #include "common.hh"
 #include "helpers.hh"
 #include "reassembler.hh"
@@ -31,6 +32,22 @@ public:
                    { Reassembler { ByteStream { capacity } } } )
   {}
 
+  ReassemblerTestHarness( std::string test_name, uint64_t capacity, ByteStream::Storage storage )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ) + ", storage=" + storage_name( storage ),
+                   { Reassembler { ByteStream { capacity, storage } } } )
+  {}
+
+  ReassemblerTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          uint64_t memory_limit,
+                          Reassembler::DropPolicy policy )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ) + ", memory_limit=" + std::to_string( memory_limit )
+                     + ", policy=" + ( policy == Reassembler::DropPolicy::Newest ? "Newest" : "Farthest" ),
+                   { Reassembler { ByteStream { capacity }, memory_limit, policy } } )
+  {}
+
   template<std::derived_from<TestStep<ByteStream>> T>
   void execute( const T& test )
   {
@@ -47,6 +64,34 @@ struct BytesPending : public ExpectNumber<Reassembler, uint64_t>
   uint64_t value( const Reassembler& r ) const override { return r.count_bytes_pending(); }
 };
 
+struct BytesBeyondWindow : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "drops().beyond_window"; }
+  uint64_t value( const Reassembler& r ) const override { return r.drops().beyond_window; }
+};
+
+struct BytesOverLimit : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "drops().over_limit"; }
+  uint64_t value( const Reassembler& r ) const override { return r.drops().over_limit; }
+};
+
+struct BytesEvicted : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "drops().evicted"; }
+  uint64_t value( const Reassembler& r ) const override { return r.drops().evicted; }
+};
+
+struct MemoryUsage : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "memory_usage"; }
+  uint64_t value( const Reassembler& r ) const override { return r.memory_usage(); }
+};
+
 struct Insert : public Action<Reassembler>
 {
   std::string data_;
@@ -3,8 +3,11 @@
 #include "reassembler_test_harness.hh"
 
 #include <algorithm>
+#include <array>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -42,6 +45,36 @@ int main()
 
       sr.execute( ReadAll { d } );
     }
+
+    // reordering far into a long stream (past 2^31 bytes)
+    {
+      constexpr uint64_t chunk = 1 << 20;
+      constexpr uint64_t half = chunk / 2;
+      constexpr uint64_t boundary = uint64_t { 1 } << 31;
+      Reassembler r { ByteStream { chunk } };
+      // in order up to a few chunks short of 2^31, then reorder each chunk across it
+      const string filler( chunk / 16, 'x' );
+      uint64_t index = 0;
+      for ( ; index < boundary - 4 * chunk; index += filler.size() ) {
+        r.insert( index, filler, false );
+        r.reader().pop( filler.size() );
+      }
+      for ( ; index < boundary + 4 * chunk; index += chunk ) {
+        const char c = static_cast<char>( 'a' + index / chunk % 26 );
+        r.insert( index + half, string( half, c ), false );
+        array<Reassembler::Range, 2> ranges;
+        const Reassembler::Range second_half { index + half, index + chunk };
+        if ( r.count_bytes_pending() != half or r.writer().bytes_pushed() != index
+             or r.stored_ranges( ranges ) != 1 or ranges[0] != second_half ) {
+          throw runtime_error( "second half of chunk at " + to_string( index ) + " not held as pending" );
+        }
+        r.insert( index, string( half, c ), false );
+        if ( r.count_bytes_pending() != 0 or r.reader().peek().front() != c or r.reader().peek().back() != c ) {
+          throw runtime_error( "chunk at " + to_string( index ) + " not reassembled" );
+        }
+        r.reader().pop( chunk );
+      }
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
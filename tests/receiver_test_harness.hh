@@ -4,9 +4,12 @@
 #include "tcp_receiver.hh"
 #include "tcp_receiver_message.hh"
 
+#include <algorithm>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -43,6 +46,19 @@ public:
                    { TCPReceiver { Reassembler { ByteStream { capacity } } } } )
   {}
 
+  // a receiver that offers to scale its windows by `window_scale`, and timestamps if `timestamps` (each in
+  // effect if the peer's SYN offers it as well)
+  TCPReceiverTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          std::optional<uint8_t> window_scale,
+                          bool timestamps = false )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ) + ", window_scale="
+                     + ( window_scale ? std::to_string( *window_scale ) : "none" )
+                     + ( timestamps ? ", timestamps" : "" ),
+                   { TCPReceiver { Reassembler { ByteStream { capacity } }, window_scale, timestamps } } )
+  {}
+
   template<std::derived_from<TestStep<Reassembler>> T>
   void execute( const T& test )
   {
@@ -65,6 +81,29 @@ struct ExpectWindow : public ExpectNumber<TCPReceiver, uint16_t>
   uint16_t value( const TCPReceiver& rs ) const override { return rs.send().window_size; }
 };
 
+// the window as advertised on our SYN, which is never scaled
+struct ExpectSynWindow : public ExpectNumber<TCPReceiver, uint16_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "window_size on the SYN"; }
+  uint16_t value( const TCPReceiver& rs ) const override { return rs.send( true ).window_size; }
+};
+
+struct ExpectWindowShift : public ExpectNumber<TCPReceiver, uint8_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "window_shift"; }
+  uint8_t value( const TCPReceiver& rs ) const override { return rs.window_shift(); }
+};
+
+// TSecr: the TSval echoed back to the peer
+struct ExpectTimestampEcho : public ExpectNumber<TCPReceiver, std::optional<uint32_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "timestamp_echo"; }
+  std::optional<uint32_t> value( const TCPReceiver& rs ) const override { return rs.send().timestamp_echo; }
+};
+
 struct ExpectAckno : public ExpectNumber<TCPReceiver, std::optional<Wrap32>>
 {
   using ExpectNumber::ExpectNumber;
@@ -108,6 +147,32 @@ struct ExpectAcknoBetween : public Expectation<TCPReceiver>
   }
 };
 
+struct ExpectSackBlocks : public Expectation<TCPReceiver>
+{
+  std::vector<SackBlock> blocks_;
+  explicit ExpectSackBlocks( std::vector<SackBlock> blocks ) : blocks_( std::move( blocks ) ) {}
+
+  static std::string to_string( std::span<const SackBlock> blocks )
+  {
+    std::string ret = "{";
+    for ( const SackBlock& block : blocks ) {
+      ret += " [" + ::to_string( block.begin ) + ", " + ::to_string( block.end ) + ")";
+    }
+    return ret + " }";
+  }
+
+  std::string description() const override { return "SACK blocks = " + to_string( blocks_ ); }
+
+  void execute( const TCPReceiver& rs ) const override
+  {
+    const TCPReceiverMessage msg = rs.send();
+    if ( not std::ranges::equal( msg.sacks(), blocks_ ) ) {
+      throw ExpectationViolation( "should have had SACK blocks = " + to_string( blocks_ ) + ", but instead it was "
+                                  + to_string( msg.sacks() ) );
+    }
+  }
+};
+
 struct HasAckno : public ExpectBool<TCPReceiver>
 {
   using ExpectBool::ExpectBool;
@@ -126,6 +191,24 @@ struct SegmentArrives : public Action<TCPReceiver>
     return *this;
   }
 
+  SegmentArrives& with_sack_permitted()
+  {
+    msg_.SACK_permitted = true;
+    return *this;
+  }
+
+  SegmentArrives& with_window_scale( uint8_t shift )
+  {
+    msg_.window_scale = shift;
+    return *this;
+  }
+
+  SegmentArrives& with_timestamp( uint32_t tsval )
+  {
+    msg_.timestamp = tsval;
+    return *this;
+  }
+
   SegmentArrives& with_fin()
   {
     msg_.FIN = true;
@@ -128,6 +128,56 @@ int main()
       test.execute( BytesPushed { 8 } );
     }
 
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "gaps reported as SACK blocks, most recent first", 2358 };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( ExpectSackBlocks { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "e" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 7 ).with_data( "g" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 3 ).with_data( "c" ) );
+      test.execute( ExpectSackBlocks { { { Wrap32 { isn + 3 }, Wrap32 { isn + 4 } },
+                                         { Wrap32 { isn + 7 }, Wrap32 { isn + 8 } },
+                                         { Wrap32 { isn + 5 }, Wrap32 { isn + 6 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 6 ).with_data( "f" ) );
+      test.execute( ExpectSackBlocks {
+        { { Wrap32 { isn + 5 }, Wrap32 { isn + 8 } }, { Wrap32 { isn + 3 }, Wrap32 { isn + 4 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "ab" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 4 } } );
+      test.execute( ExpectSackBlocks { { { Wrap32 { isn + 5 }, Wrap32 { isn + 8 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 4 ).with_data( "d" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 8 } } );
+      test.execute( ExpectSackBlocks { {} } );
+      test.execute( ReadAll { "abcdefg" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "at most four SACK blocks", 2358 };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      for ( uint32_t i = 2; i <= 10; i += 2 ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + i ).with_data( "x" ) );
+      }
+      test.execute( ExpectSackBlocks { { { Wrap32 { isn + 10 }, Wrap32 { isn + 11 } },
+                                         { Wrap32 { isn + 8 }, Wrap32 { isn + 9 } },
+                                         { Wrap32 { isn + 6 }, Wrap32 { isn + 7 } },
+                                         { Wrap32 { isn + 4 }, Wrap32 { isn + 5 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "x" ) );
+      test.execute( ExpectSackBlocks { { { Wrap32 { isn + 4 }, Wrap32 { isn + 7 } },
+                                         { Wrap32 { isn + 10 }, Wrap32 { isn + 11 } },
+                                         { Wrap32 { isn + 8 }, Wrap32 { isn + 9 } },
+                                         { Wrap32 { isn + 2 }, Wrap32 { isn + 3 } } } } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no SACK blocks unless the SYN permitted them", 2358 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "e" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSackBlocks { {} } );
+    }
+
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
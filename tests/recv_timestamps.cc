@@ -0,0 +1,96 @@
+#include "byte_stream_test_harness.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "The lab's receiver ignores timestamps", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_timestamp( 100 ) );
+      test.execute( ExpectTimestampEcho { nullopt } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 50 ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 9 } } );
+      test.execute( ExpectTimestampEcho { nullopt } );
+    }
+
+    {
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "TSecr echoes the latest in-order TSval", 4000, nullopt, true };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_timestamp( 100 ) );
+      test.execute( ExpectTimestampEcho { 100 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 105 ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 5 } } );
+      test.execute( ExpectTimestampEcho { 105 } );
+      // a segment past a hole doesn't update TS.Recent: the ack it triggers answers the segment that was lost
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ).with_timestamp( 200 ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 5 } } );
+      test.execute( ExpectTimestampEcho { 105 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ).with_timestamp( 210 ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 13 } } );
+      test.execute( ExpectTimestampEcho { 210 } );
+      // a duplicate of old data (with a newer TSval) starts before the ackno, so it does
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 220 ) );
+      test.execute( ExpectTimestampEcho { 220 } );
+    }
+
+    {
+      const uint32_t isn = 1000;
+      TCPReceiverTestHarness test { "PAWS drops segments with an older TSval", 4000, nullopt, true };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_timestamp( 5000 ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_timestamp( 5010 ) );
+      test.execute( BytesPushed { 4 } );
+      // an old duplicate whose seqno happens to look new
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "stale" ).with_timestamp( 4000 ) );
+      test.execute( BytesPushed { 4 } );
+      test.execute( ExpectAckno { Wrap32 { isn + 5 } } );
+      test.execute( ExpectTimestampEcho { 5010 } );
+      // the same TSval is not older
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ).with_timestamp( 5010 ) );
+      test.execute( BytesPushed { 8 } );
+      // "older" is modulo 2^32: up to 2^31 - 1 ahead is newer, even across the wrap
+      const uint32_t far_ahead = 5010 + ( 1U << 31 ) - 1;
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ).with_timestamp( far_ahead ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mnop" ).with_timestamp( 10 ) );
+      test.execute( BytesPushed { 16 } );
+      test.execute( ExpectTimestampEcho { 10 } );
+    }
+
+    {
+      const uint32_t isn = 1000;
+      TCPReceiverTestHarness test { "Once in use, segments without timestamps are dropped", 4000, nullopt, true };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_timestamp( 1 ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( BytesPushed { 0 } );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      // but not a reset
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_rst() );
+      test.execute( ExpectReset { true } );
+    }
+
+    {
+      const uint32_t isn = 1000;
+      TCPReceiverTestHarness test { "No timestamps when the peer's SYN doesn't carry them", 4000, nullopt, true };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectTimestampEcho { nullopt } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( BytesPushed { 4 } );
+      test.execute( ExpectTimestampEcho { nullopt } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -106,6 +106,47 @@ int main()
       test.execute( BytesPending( 0 ) );
     }
 
+    {
+      // 1,000,000 bytes don't fit in 16 bits: advertised in units of 2^4 bytes once both SYNs offer to scale
+      const size_t cap = 1'000'000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "window scaled when both sides offer", cap, uint8_t { 4 } };
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 2 ).with_seqno( isn ) );
+      test.execute( ExpectWindowShift { 4 } );
+      test.execute( ExpectWindow { cap >> 4 } );
+      test.execute( ExpectSynWindow { UINT16_MAX } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 100, 'x' ) ) );
+      test.execute( ExpectWindow { ( cap - 100 ) >> 4 } );
+    }
+
+    {
+      const size_t cap = 1'000'000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "window not scaled when the peer doesn't offer", cap, uint8_t { 4 } };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindowShift { 0 } );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const size_t cap = 1'000'000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "window not scaled when we don't offer", cap };
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindowShift { 0 } );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      // a shift of more than 14 is treated as 14 (RFC 7323 2.3)
+      const size_t cap = 4000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "window shift capped", cap, uint8_t { 20 } };
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 0 ).with_seqno( isn ) );
+      test.execute( ExpectWindowShift { 14 } );
+      test.execute( ExpectWindow { 0 } );
+    }
+
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
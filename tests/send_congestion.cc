@@ -0,0 +1,139 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+void expect_segments( TCPSenderTestHarness& test, Wrap32 first_seqno, uint64_t count )
+{
+  for ( uint64_t i = 0; i < count; i++ ) {
+    test.execute( ExpectMessage {}.with_seqno( first_seqno + i * MSS ).with_payload_size( MSS ) );
+  }
+  test.execute( ExpectNoSegment {} );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "No congestion control: the receiver's window is the limit",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      connect( test, isn );
+      test.execute( ExpectCongestionWindow { UINT64_MAX } );
+      test.execute( Push { string( 20 * MSS, 'x' ) } );
+      expect_segments( test, isn + 1, 20 );
+      test.execute( ExpectSeqnosInFlight { 20 * MSS } );
+    }
+
+    for ( const auto algorithm : { CongestionControl::Algorithm::NewReno, CongestionControl::Algorithm::Cubic } ) {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Slow start from the initial window", config( algorithm, isn ), true };
+      connect( test, isn );
+
+      // RFC 5681 initial window: the SYN's ack doesn't grow it, since the SYN didn't fill the window
+      test.execute( ExpectCongestionWindow { 4 * MSS } );
+      test.execute( Push { string( 40 * MSS, 'x' ) } );
+      expect_segments( test, isn + 1, 4 );
+      test.execute( ExpectSeqnosInFlight { 4 * MSS } );
+
+      // each ack of a full segment grows the window by a segment, releasing two more
+      test.execute( AckReceived { isn + 1 + MSS }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 5 * MSS } );
+      expect_segments( test, isn + 1 + 4 * MSS, 2 );
+      test.execute( AckReceived { isn + 1 + 6 * MSS }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 6 * MSS } );
+      expect_segments( test, isn + 1 + 6 * MSS, 6 );
+      test.execute( ExpectSeqnosInFlight { 6 * MSS } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "NewReno: timeout, slow start to ssthresh, then congestion avoidance",
+                                  config( CongestionControl::Algorithm::NewReno, isn ),
+                                  true };
+      connect( test, isn );
+      test.execute( Push { string( 40 * MSS, 'x' ) } );
+      expect_segments( test, isn + 1, 4 );
+      test.execute( AckReceived { isn + 1 + MSS }.with_win( BIG_WINDOW ) );
+      expect_segments( test, isn + 1 + 4 * MSS, 2 );
+      test.execute( ExpectSeqnosInFlight { 5 * MSS } );
+
+      // the timeout halves what was in flight into ssthresh and drops to one segment
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 + MSS ).with_payload_size( MSS ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { MSS } );
+      test.execute( ExpectSlowStartThreshold { 5 * MSS / 2 } );
+
+      // a second timeout in a row leaves ssthresh alone
+      test.execute( Tick { 2 * TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 + MSS ).with_payload_size( MSS ) );
+      test.execute( ExpectSlowStartThreshold { 5 * MSS / 2 } );
+
+      // slow start while below ssthresh (the outstanding segments still count against the window)
+      test.execute( AckReceived { isn + 1 + 2 * MSS }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 2 * MSS } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 + 2 * MSS ) ); // partial ack: resend the next hole
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1 + 6 * MSS }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 3 * MSS } );
+      expect_segments( test, isn + 1 + 6 * MSS, 3 );
+
+      // congestion avoidance: one segment more per window's worth of acked bytes
+      test.execute( AckReceived { isn + 1 + 8 * MSS }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 3 * MSS } );
+      expect_segments( test, isn + 1 + 9 * MSS, 2 );
+      test.execute( AckReceived { isn + 1 + 9 * MSS }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 4 * MSS } );
+      expect_segments( test, isn + 1 + 11 * MSS, 2 );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test {
+        "CUBIC: timeout sets ssthresh to 0.7 cwnd", config( CongestionControl::Algorithm::Cubic, isn ), true };
+      connect( test, isn );
+      test.execute( Push { string( 40 * MSS, 'x' ) } );
+      expect_segments( test, isn + 1, 4 );
+      for ( uint64_t i = 1; i <= 6; i++ ) {
+        test.execute( AckReceived { isn + 1 + i * MSS }.with_win( BIG_WINDOW ) );
+      }
+      test.execute( ExpectCongestionWindow { 10 * MSS } );
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectCongestionWindow { MSS } );
+      test.execute( ExpectSlowStartThreshold { 7 * MSS } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      TCPSenderTestHarness test { "The receiver's window still applies under congestion control", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 2500 ) );
+      test.execute( Push { string( 40 * MSS, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 2500 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+// The seqno of the `index`th full segment of the stream
+Wrap32 segment( Wrap32 isn, uint64_t index )
+{
+  return isn + 1 + static_cast<uint32_t>( index * MSS );
+}
+
+// With NewReno from the initial window of 4 segments, ack the first 6 segments one at a time: slow start
+// takes cwnd to 10 segments, with segments 6 through 15 in flight
+void open_to_ten_segments( TCPSenderTestHarness& test, Wrap32 isn )
+{
+  test.execute( Push { string( 40 * MSS, 'x' ) } );
+  for ( uint64_t i = 0; i < 4; i++ ) {
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+  }
+  for ( uint64_t i = 1; i <= 6; i++ ) {
+    test.execute( AckReceived { segment( isn, i ) }.with_win( BIG_WINDOW ) );
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, 2 + 2 * i ) ) );
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, 3 + 2 * i ) ) );
+  }
+  test.execute( ExpectNoSegment {} );
+  test.execute( ExpectCongestionWindow { 10 * MSS } );
+  test.execute( ExpectSeqnosInFlight { 10 * MSS } );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test {
+        "Third duplicate ack retransmits at once", config( CongestionControl::Algorithm::None, isn ), true };
+      connect( test, isn );
+      test.execute( Push { string( 10 * MSS, 'x' ) } );
+      for ( uint64_t i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+      }
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectNoSegment {} );
+
+      // one round trip after the loss, not one RTO
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 1 ) ).with_payload_size( MSS ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 10 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Only acks that repeat the ackno and the window are duplicates",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      connect( test, isn );
+      test.execute( Push { string( 10 * MSS, 'x' ) } );
+      for ( uint64_t i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+      }
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW - 1 ) ); // window update
+      test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW - 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 2 ) }.with_win( BIG_WINDOW - 1 ) ); // new data acked
+      test.execute( AckReceived { segment( isn, 2 ) }.with_win( BIG_WINDOW - 1 ) );
+      test.execute( AckReceived { segment( isn, 2 ) }.with_win( BIG_WINDOW - 1 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      TCPSenderTestHarness test { "No fast retransmit for the lab's sender", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( BIG_WINDOW ) );
+      test.execute( Push { string( 5 * MSS, 'x' ) } );
+      for ( uint64_t i = 0; i < 5; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+      }
+      for ( uint64_t i = 0; i < 5; i++ ) {
+        test.execute( AckReceived { segment( isn, 1 ) }.with_win( BIG_WINDOW ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "NewReno fast recovery: halve, inflate, then deflate on the full ack",
+                                  config( CongestionControl::Algorithm::NewReno, isn ),
+                                  true };
+      connect( test, isn );
+      open_to_ten_segments( test, isn );
+
+      // segment 6 is lost: the three duplicates bring ssthresh to half the flight, cwnd to ssthresh + 3
+      for ( uint64_t i = 0; i < 3; i++ ) {
+        test.execute( AckReceived { segment( isn, 6 ) }.with_win( BIG_WINDOW ) );
+      }
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 6 ) ).with_payload_size( MSS ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSlowStartThreshold { 5 * MSS } );
+      test.execute( ExpectCongestionWindow { 8 * MSS } );
+
+      // each further duplicate inflates cwnd by a segment; new data goes out once cwnd exceeds the flight
+      test.execute( AckReceived { segment( isn, 6 ) }.with_win( BIG_WINDOW ) );
+      test.execute( AckReceived { segment( isn, 6 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 6 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 11 * MSS } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 16 ) ) );
+      test.execute( ExpectNoSegment {} );
+
+      // the ack of everything outstanding at the loss ends recovery: cwnd = min( ssthresh, flight + 1 segment )
+      test.execute( AckReceived { segment( isn, 16 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 2 * MSS } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 17 ) ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "NewReno partial ack: the next hole goes out without waiting for an RTO",
+                                  config( CongestionControl::Algorithm::NewReno, isn ),
+                                  true };
+      connect( test, isn );
+      open_to_ten_segments( test, isn );
+
+      // segments 6 and 9 are lost
+      for ( uint64_t i = 0; i < 3; i++ ) {
+        test.execute( AckReceived { segment( isn, 6 ) }.with_win( BIG_WINDOW ) );
+      }
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 6 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 9 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 9 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 6 * MSS } ); // 8, less the 3 acked, plus 1
+      test.execute( AckReceived { segment( isn, 16 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectCongestionWindow { 2 * MSS } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 16 ) ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 17 ) ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "After a timeout, each partial ack resends the next hole",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      connect( test, isn );
+      test.execute( Push { string( 10 * MSS, 'x' ) } );
+      for ( uint64_t i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+      }
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 0 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 3 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 3 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 7 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 7 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { segment( isn, 10 ) }.with_win( BIG_WINDOW ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+TCPConfig config( Wrap32 isn, uint16_t mss )
+{
+  TCPConfig cfg;
+  cfg.isn = isn;
+  cfg.mss = mss;
+  cfg.congestion_control = CongestionControl::Algorithm::None;
+  cfg.send_capacity = 100'000;
+  return cfg;
+}
+
+// Connect to a peer whose SYN offers `peer_mss`, then send enough to fill a few segments
+void connect_with_peer_mss( TCPSenderTestHarness& test, Wrap32 isn, optional<uint16_t> peer_mss )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+  test.execute( AckReceived { isn + 1 }.with_win( 60'000 ) );
+  test.execute( PeerMSS { peer_mss } );
+  test.execute( Push { string( 30'000, 'x' ) } );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      test_should_be( TCPConfig::mss_for_mtu( 1500 ), uint16_t { 1460 } );
+      test_should_be( TCPConfig::mss_for_mtu( 9000 ), uint16_t { 8960 } );
+      // every host takes 576-byte datagrams
+      test_should_be( TCPConfig::mss_for_mtu( 100 ), uint16_t { 536 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      TCPSenderTestHarness test { "The lab's sender doesn't announce an MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( nullopt ) );
+      test.execute( ExpectMaxPayloadSize { TCPConfig::MAX_PAYLOAD_SIZE } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "SYN announces the MSS", config( isn, 1460 ), true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 1460 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 10'000 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_mss( nullopt ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Segments fill the MSS both sides accept", config( isn, 1460 ), true };
+      connect_with_peer_mss( test, isn, 1460 );
+      test.execute( ExpectMaxPayloadSize { 1460 } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 1460 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1461 ).with_payload_size( 1460 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "The peer's smaller MSS limits segments", config( isn, 1460 ), true };
+      connect_with_peer_mss( test, isn, 1200 );
+      test.execute( ExpectMessage {}.with_payload_size( 1200 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Our own smaller MSS limits them too", config( isn, 1460 ), true };
+      connect_with_peer_mss( test, isn, 8960 );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "A peer without the MSS option accepts 536 bytes", config( isn, 1460 ), true };
+      connect_with_peer_mss( test, isn, nullopt );
+      test.execute( ExpectMessage {}.with_payload_size( 536 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Jumbo frames", config( isn, 8960 ), true };
+      connect_with_peer_mss( test, isn, 8960 );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 8961 ).with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 17921 ).with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 26881 ).with_payload_size( 3120 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Timestamps come out of the MSS", config( isn, 1460 ), true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 1460 ).with_timestamp( 0 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 10'000 ).with_timestamp_echo( 0 ) );
+      test.execute( PeerTimestamps { true } );
+      test.execute( PeerMSS { 1460 } );
+      test.execute( ExpectMaxPayloadSize { 1448 } );
+      test.execute( Push { string( 2000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1448 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 552 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "A peer's MSS of 0 is raised to the minimum", config( isn, 1460 ), true };
+      connect_with_peer_mss( test, isn, 0 );
+      test.execute( ExpectMaxPayloadSize { 88 } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 88 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 89 ).with_payload_size( 88 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "A peer's MSS smaller than the timestamps still leaves a payload",
+                                  config( isn, 1460 ),
+                                  true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_timestamp( 0 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 10'000 ).with_timestamp_echo( 0 ) );
+      test.execute( PeerTimestamps { true } );
+      test.execute( PeerMSS { 8 } );
+      test.execute( ExpectMaxPayloadSize { 76 } ); // the minimum MSS, less the timestamps
+      test.execute( Push { "0123456789" } );
+      test.execute( ExpectMessage {}.with_data( "0123456789" ) );
+      test.execute( Push { string( 200, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 76 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPConfig cfg = config( isn, 1460 );
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+      TCPSenderTestHarness test { "The initial window follows the MSS", cfg, true };
+      test.execute( ExpectCongestionWindow { 4380 } ); // RFC 5681: min( 4 * 1460, max( 2 * 1460, 4380 ) )
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60'000 ) );
+      test.execute( PeerMSS { 536 } );
+      test.execute( ExpectCongestionWindow { 2144 } ); // 4 * 536
+
+      cfg.mss = 8960;
+      TCPSenderTestHarness jumbo { "The initial window follows a jumbo MSS", cfg, true };
+      jumbo.execute( ExpectCongestionWindow { 17920 } ); // 2 * 8960
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
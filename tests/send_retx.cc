@@ -198,6 +198,76 @@ int main()
       test.execute( ExpectSeqnosInFlight { 0 } );
       test.execute( HasError { false } );
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> { 10, 10000 }( rd );
+      cfg.isn = isn;
+      cfg.rt_timeout = retx_timeout;
+      const size_t seg = TCPConfig::MAX_PAYLOAD_SIZE;
+      string data;
+      for ( size_t i = 0; i < 70 * seg; i++ ) {
+        data += static_cast<char>( 'a' + rd() % 26 );
+      }
+
+      // the retransmitted payloads are re-read from the outbound stream, after the stream's buffer and the
+      // queue of outstanding segments have both wrapped around
+      TCPSenderTestHarness test { "Retx earliest of many segments, re-read from the stream", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 65000 ) );
+      test.execute( Push { data.substr( 0, 40 * seg ) } );
+      for ( size_t i = 0; i < 40; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( isn + 1 + i * seg ).with_data( data.substr( i * seg, seg ) ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { Wrap32 { isn + 1 + 30 * seg } }.with_win( 65000 ) );
+      test.execute( ExpectSeqnosInFlight { 10 * seg } );
+      test.execute( Push { data.substr( 40 * seg ) } );
+      for ( size_t i = 40; i < 70; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( isn + 1 + i * seg ).with_data( data.substr( i * seg, seg ) ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 40 * seg } );
+      for ( size_t i = 30; i < 70; i += 10 ) {
+        test.execute( Tick { retx_timeout }.with_max_retx_exceeded( false ) );
+        test.execute( ExpectMessage {}.with_seqno( isn + 1 + i * seg ).with_data( data.substr( i * seg, seg ) ) );
+        test.execute( ExpectNoSegment {} );
+        test.execute( AckReceived { Wrap32 { isn + 1 + ( i + 10 ) * seg } }.with_win( 65000 ) );
+      }
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( Tick { retx_timeout } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+      cfg.send_storage = ByteStream::Storage::Chunked;
+
+      // each push is one chunk of the outbound stream and fills one segment, so the segments carry the chunks
+      // themselves: they have to be back in the stream, intact, for the retransmissions
+      TCPSenderTestHarness test { "Segments that are whole chunks retransmit intact", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 4000 ) );
+      const string first( 1000, 'a' );
+      const string second( 600, 'b' );
+      test.execute( Push { first } );
+      test.execute( Push { second } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_data( first ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1001 ).with_data( second ) );
+      test.execute( Tick { 1000 } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_data( first ) );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 4000 ) );
+      test.execute( Tick { 1000 } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1001 ).with_data( second ) );
+      test.execute( AckReceived { Wrap32 { isn + 1601 } }.with_win( 4000 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
@@ -0,0 +1,155 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+
+      TCPSenderTestHarness test { "Fixed RTO doesn't learn from acks", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectRTO { 1000 } );
+      test.execute( ExpectSmoothedRTT { nullopt } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+      cfg.rt_timeout_min = 50;
+
+      TCPSenderTestHarness test { "First RTT sample sets SRTT = R, RTTVAR = R/2", cfg, true };
+      test.execute( ExpectRTO { 1000 } );
+      test.execute( ExpectSmoothedRTT { nullopt } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 100 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSmoothedRTT { 100 } );
+      test.execute( ExpectRTO { 300 } ); // 100 + 4 * 50
+
+      // later samples are smoothed: RTTVAR = 3/4 * 50 + 1/4 * 80 = 57.5, SRTT = 7/8 * 100 + 1/8 * 20 = 90
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 20 } );
+      test.execute( AckReceived { Wrap32 { isn + 4 } } );
+      test.execute( ExpectSmoothedRTT { 90 } );
+      test.execute( ExpectRTO { 320 } );
+
+      // the retransmission timer runs on the new RTO
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 319 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( ExpectRTO { 640 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+      cfg.rt_timeout_min = 50;
+
+      TCPSenderTestHarness test { "Karn: no sample from a retransmitted segment", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 100 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectRTO { 300 } );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 300 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( ExpectRTO { 600 } );
+      test.execute( ExpectConsecutiveRetransmissions { 1 } );
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { Wrap32 { isn + 4 } } ); // ambiguous: 305 ms after the first send, or 5 ms?
+      test.execute( ExpectSmoothedRTT { 100 } );
+      test.execute( ExpectRTO { 300 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+
+      // a later segment that was sent only once is timed again
+      test.execute( Push { "g" } );
+      test.execute( ExpectMessage {}.with_data( "g" ) );
+      test.execute( Tick { 100 } );
+      test.execute( AckReceived { Wrap32 { isn + 5 } } );
+      test.execute( ExpectSmoothedRTT { 100 } );
+      test.execute( ExpectRTO { 250 } ); // RTTVAR = 3/4 * 50
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+      cfg.rt_timeout_min = 50;
+
+      TCPSenderTestHarness test { "RTO doesn't drop below the floor", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 1 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSmoothedRTT { 1 } );
+      test.execute( ExpectRTO { 50 } );
+      for ( uint32_t i = 0; i < 20; i++ ) {
+        test.execute( Push { "x" } );
+        test.execute( ExpectMessage {}.with_data( "x" ) );
+        test.execute( Tick { 1 } );
+        test.execute( AckReceived { Wrap32 { isn + 2 + i } } );
+      }
+      test.execute( ExpectSmoothedRTT { 1 } );
+      test.execute( ExpectRTO { 50 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 1000;
+      cfg.rt_timeout_max = 4000;
+
+      TCPSenderTestHarness test { "Back-off stops at the ceiling", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      for ( const uint64_t rto : { 1000, 2000, 4000, 4000, 4000 } ) {
+        test.execute( Tick { rto - 1 } );
+        test.execute( ExpectNoSegment {} );
+        test.execute( Tick { 1 } );
+        test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      }
+      test.execute( ExpectRTO { 4000 } );
+      test.execute( ExpectConsecutiveRetransmissions { 5 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSmoothedRTT { nullopt } );
+      test.execute( ExpectRTO { 1000 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
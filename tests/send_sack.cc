@@ -0,0 +1,220 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+// The seqno of the `index`th full segment of the stream
+Wrap32 segment( Wrap32 isn, uint64_t index )
+{
+  return isn + 1 + static_cast<uint32_t>( index * MSS );
+}
+
+// A SACK block covering segments [first, last)
+SackBlock segments( Wrap32 isn, uint64_t first, uint64_t last )
+{
+  return { segment( isn, first ), segment( isn, last ) };
+}
+
+// An ack of everything before the `index`th segment, in the big window
+AckReceived ack( Wrap32 isn, uint64_t index )
+{
+  AckReceived ret { segment( isn, index ) };
+  ret.with_win( BIG_WINDOW );
+  return ret;
+}
+
+// Push `count` segments' worth of data and expect them all to go out
+void send_segments( TCPSenderTestHarness& test, Wrap32 isn, uint64_t count )
+{
+  test.execute( Push { string( count * MSS, 'x' ) } );
+  for ( uint64_t i = 0; i < count; i++ ) {
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+  }
+  test.execute( ExpectNoSegment {} );
+}
+
+// With NewReno from the initial window of 4 segments, ack the first 6 segments one at a time: slow start
+// takes cwnd to 10 segments, with segments 6 through 15 in flight
+void open_to_ten_segments( TCPSenderTestHarness& test, Wrap32 isn )
+{
+  test.execute( Push { string( 40 * MSS, 'x' ) } );
+  for ( uint64_t i = 0; i < 4; i++ ) {
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, i ) ) );
+  }
+  for ( uint64_t i = 1; i <= 6; i++ ) {
+    test.execute( AckReceived { segment( isn, i ) }.with_win( BIG_WINDOW ) );
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, 2 + 2 * i ) ) );
+    test.execute( ExpectMessage {}.with_seqno( segment( isn, 3 + 2 * i ) ) );
+  }
+  test.execute( ExpectNoSegment {} );
+  test.execute( ExpectCongestionWindow { 10 * MSS } );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      TCPSenderTestHarness test { "The lab's sender doesn't offer SACK", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( false ).with_seqno( isn ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "SYN-ACK permits SACK in reply to a SYN that did",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      test.execute( PeerSackPermitted { true } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( true ).with_seqno( isn ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "SYN-ACK doesn't permit SACK to a SYN without it",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      test.execute( PeerSackPermitted { false } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( false ).with_seqno( isn ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Three holes in a window: only the holes are resent",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      connect( test, isn );
+      send_segments( test, isn, 10 );
+
+      // segments 1, 4 and 7 are lost
+      test.execute( ack( isn, 1 ) );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 2, 3 ) } ) );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 2, 4 ) } ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 5, 6 ), segments( isn, 2, 4 ) } ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 1 ) ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 4 ) ) );
+      test.execute( ExpectNoSegment {} );
+
+      // segment 7 is a hole once something past it is SACKed
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 5, 7 ), segments( isn, 2, 4 ) } ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        ack( isn, 1 ).with_sack( { segments( isn, 8, 9 ), segments( isn, 5, 7 ), segments( isn, 2, 4 ) } ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 7 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        ack( isn, 1 ).with_sack( { segments( isn, 8, 10 ), segments( isn, 5, 7 ), segments( isn, 2, 4 ) } ) );
+      test.execute( ExpectNoSegment {} );
+
+      // the retransmissions arrive: partial acks resend nothing more
+      test.execute( ack( isn, 4 ).with_sack( { segments( isn, 8, 10 ), segments( isn, 5, 7 ) } ) );
+      test.execute( ack( isn, 7 ).with_sack( { segments( isn, 8, 10 ) } ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ack( isn, 10 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPConfig cfg = config( CongestionControl::Algorithm::None, isn );
+      cfg.sack = false;
+      TCPSenderTestHarness test {
+        "Without SACK, blocks are ignored and recovery goes one hole at a time", cfg, true };
+      connect( test, isn, false );
+      send_segments( test, isn, 10 );
+      test.execute( ack( isn, 1 ) );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 2, 3 ) } ) );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 2, 4 ) } ) );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 5, 6 ), segments( isn, 2, 4 ) } ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 1 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ack( isn, 4 ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 4 ) ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "NewReno with SACK: the pipe, not the inflated window, paces the recovery",
+                                  config( CongestionControl::Algorithm::NewReno, isn ),
+                                  true };
+      connect( test, isn );
+      open_to_ten_segments( test, isn );
+
+      // segments 6 and 9 are lost
+      test.execute( ack( isn, 6 ).with_sack( { segments( isn, 7, 8 ) } ) );
+      test.execute( ack( isn, 6 ).with_sack( { segments( isn, 7, 9 ) } ) );
+      test.execute( ack( isn, 6 ).with_sack( { segments( isn, 10, 11 ), segments( isn, 7, 9 ) } ) );
+      test.execute( ExpectSlowStartThreshold { 5 * MSS } );
+      test.execute( ExpectCongestionWindow { 5 * MSS } );
+      // the first hole goes out at once; then the pipe (10 in flight, 3 SACKed, 1 lost) fills the window
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 6 ) ) );
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( ack( isn, 6 ).with_sack( { segments( isn, 10, 12 ), segments( isn, 7, 9 ) } ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ack( isn, 6 ).with_sack( { segments( isn, 10, 13 ), segments( isn, 7, 9 ) } ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 9 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ack( isn, 6 ).with_sack( { segments( isn, 10, 14 ), segments( isn, 7, 9 ) } ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 16 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 5 * MSS } );
+
+      // the partial ack leaves cwnd alone; what it acked leaves the pipe
+      test.execute( ack( isn, 9 ).with_sack( { segments( isn, 10, 14 ) } ) );
+      test.execute( ExpectCongestionWindow { 5 * MSS } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 17 ) ) );
+      test.execute( ExpectNoSegment {} );
+
+      // recovery ends with cwnd = min( ssthresh, flight + 1 segment )
+      test.execute( ack( isn, 16 ) );
+      test.execute( ExpectCongestionWindow { 3 * MSS } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 18 ) ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "After a timeout, SACKed segments are not resent",
+                                  config( CongestionControl::Algorithm::None, isn ),
+                                  true };
+      connect( test, isn );
+      send_segments( test, isn, 6 );
+      test.execute( ack( isn, 1 ) );
+      test.execute( ack( isn, 1 ).with_sack( { segments( isn, 4, 5 ), segments( isn, 2, 3 ) } ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 1 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 3 ) ) );
+      test.execute( ExpectMessage {}.with_seqno( segment( isn, 5 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ack( isn, 6 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+TCPConfig config( Wrap32 isn )
+{
+  TCPConfig cfg;
+  cfg.isn = isn;
+  cfg.congestion_control = CongestionControl::Algorithm::None;
+  cfg.rt_timeout = 1000;
+  cfg.rt_timeout_min = 50;
+  return cfg;
+}
+
+// SYN at t=0, acked at t=100 with its TSval echoed: SRTT = 100, RTTVAR = 50, RTO = 300
+void connect_with_timestamps( TCPSenderTestHarness& test, Wrap32 isn )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ).with_timestamp( 0 ) );
+  test.execute( Tick { 100 } );
+  test.execute( AckReceived { isn + 1 }.with_win( 4000 ).with_timestamp_echo( 0 ) );
+  test.execute( PeerTimestamps { true } );
+  test.execute( ExpectSmoothedRTT { 100 } );
+  test.execute( ExpectRTO { 300 } );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      TCPSenderTestHarness test { "The lab's sender doesn't stamp its segments", cfg };
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_syn( true ).with_timestamp( nullopt ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "TSval is the sender's clock, in milliseconds", config( isn ), true };
+      connect_with_timestamps( test, isn );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( 100 ) );
+      test.execute( Tick { 7 } );
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ).with_timestamp( 107 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "An echoed TSval times a retransmission", config( isn ), true };
+      connect_with_timestamps( test, isn );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( 100 ) );
+      test.execute( Tick { 300 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( 400 ) );
+      // the ack echoes the retransmission's TSval, so it is an RTT sample of 50 ms (Karn's algorithm would
+      // have discarded it): SRTT = 7/8 * 100 + 1/8 * 50
+      test.execute( Tick { 50 } );
+      test.execute( AckReceived { isn + 4 }.with_timestamp_echo( 400 ) );
+      test.execute( ExpectSmoothedRTT { 93 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Every ack that advances is a sample", config( isn ), true };
+      connect_with_timestamps( test, isn );
+      // the timestamps option takes 12 bytes of every segment's 1000-byte MSS
+      test.execute( ExpectMaxPayloadSize { 988 } );
+      test.execute( Push { string( 3 * 988, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 988 ).with_timestamp( 100 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 988 ).with_timestamp( 100 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 988 ).with_timestamp( 100 ) );
+      test.execute( Tick { 20 } );
+      test.execute( AckReceived { isn + 989 }.with_win( 4000 ).with_timestamp_echo( 100 ) );
+      test.execute( ExpectSmoothedRTT { 90 } ); // 7/8 * 100 + 1/8 * 20
+      test.execute( AckReceived { isn + 1977 }.with_win( 4000 ).with_timestamp_echo( 100 ) );
+      test.execute( ExpectSmoothedRTT { 81 } ); // 7/8 * 90 + 1/8 * 20, rounded down
+      // an ack that doesn't advance isn't
+      test.execute( AckReceived { isn + 1977 }.with_win( 4000 ).with_timestamp_echo( 100 ) );
+      test.execute( ExpectSmoothedRTT { 81 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "An echo from the future isn't a sample", config( isn ), true };
+      connect_with_timestamps( test, isn );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 20 } );
+      test.execute( AckReceived { isn + 4 }.with_timestamp_echo( 5000 ) );
+      test.execute( ExpectSmoothedRTT { 100 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "No timestamps when the peer's SYN doesn't carry them", config( isn ), true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_timestamp( 0 ) );
+      test.execute( Tick { 100 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( PeerTimestamps { false } );
+      test.execute( ExpectSmoothedRTT { 100 } );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( nullopt ) );
+      test.execute( Tick { 300 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( nullopt ) );
+      // Karn's algorithm: the ack of a retransmitted segment isn't a sample
+      test.execute( AckReceived { isn + 4 } );
+      test.execute( ExpectSmoothedRTT { 100 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPConfig cfg = config( isn );
+      cfg.timestamps = false;
+      TCPSenderTestHarness test { "No timestamps when our SYN doesn't offer them", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_timestamp( nullopt ) );
+      test.execute( AckReceived { isn + 1 }.with_timestamp_echo( 0 ) );
+      test.execute( PeerTimestamps { true } );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_timestamp( nullopt ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
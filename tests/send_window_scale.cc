@@ -0,0 +1,131 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+TCPConfig config( Wrap32 isn )
+{
+  TCPConfig cfg;
+  cfg.isn = isn;
+  cfg.congestion_control = CongestionControl::Algorithm::None;
+  cfg.send_capacity = 4'000'000;
+  cfg.recv_capacity = 1'000'000;
+  return cfg;
+}
+
+// The peer's SYN-ACK opens a 1000-byte window: it is never scaled, even if the SYN offers a shift count
+void connect_with_peer_window_scale( TCPSenderTestHarness& test, Wrap32 isn, optional<uint8_t> peer_window_scale )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+  test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+  test.execute( PeerWindowScale { peer_window_scale } );
+  test.execute( Push { string( 200'000, 'x' ) } );
+  test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 1000 ) );
+  test.execute( ExpectNoSegment {} );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      TCPSenderTestHarness test { "The lab's sender doesn't offer window scaling", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( nullopt ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPConfig cfg = config( isn );
+      TCPSenderTestHarness test { "SYN offers the shift that fits the receive capacity in 16 bits", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( 4 ) );
+
+      cfg.recv_capacity = 64'000;
+      TCPSenderTestHarness small { "A window that fits in 16 bits still offers to scale", cfg, true };
+      small.execute( Push {} );
+      small.execute( ExpectMessage {}.with_syn( true ).with_window_scale( 0 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "Windows after the SYN-ACK are scaled by the peer's shift", config( isn ), true };
+      connect_with_peer_window_scale( test, isn, 7 );
+      test.execute( AckReceived { isn + 1001 }.with_win( 1000 ) );
+      test.execute( ExpectSeqnosInFlight { 128'000 } );
+      for ( uint64_t i = 0; i < 128'000 / MSS; i++ ) {
+        test.execute( ExpectMessage {}.with_seqno( isn + 1001 + static_cast<uint32_t>( i * MSS ) ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "More than 64 KiB in flight", config( isn ), true };
+      connect_with_peer_window_scale( test, isn, 14 );
+      test.execute( Push { string( 3'000'000, 'x' ) } );
+      test.execute( AckReceived { isn + 1001 }.with_win( UINT16_MAX ) );
+      // the window (65535 << 14 bytes) is bigger than the stream: everything pushed goes out
+      test.execute( ExpectSeqnosInFlight { 3'199'000 } );
+      test.execute( AckReceived { isn + 1'001 + 3'000'000 }.with_win( 1 ) );
+      test.execute( ExpectSeqnosInFlight { 199'000 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "No scaling when the peer's SYN doesn't offer it", config( isn ), true };
+      connect_with_peer_window_scale( test, isn, nullopt );
+      test.execute( AckReceived { isn + 1001 }.with_win( 1000 ) );
+      test.execute( ExpectSeqnosInFlight { 1000 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "SYN-ACK offers scaling in reply to a SYN that did", config( isn ), true };
+      test.execute( PeerWindowScale { 7 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( 4 ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "SYN-ACK doesn't offer scaling to a SYN without it", config( isn ), true };
+      test.execute( PeerWindowScale { nullopt } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( nullopt ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPConfig cfg = config( isn );
+      cfg.window_scaling = false;
+      TCPSenderTestHarness test { "No scaling when our SYN doesn't offer it", cfg, true };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( nullopt ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+      test.execute( PeerWindowScale { 7 } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 1000 ) );
+      test.execute( ExpectSeqnosInFlight { 1000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
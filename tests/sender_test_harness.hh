@@ -7,6 +7,8 @@
 #include "tcp_sender.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <initializer_list>
 #include <optional>
 #include <queue>
 #include <sstream>
@@ -58,6 +60,18 @@ public:
                    { TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
   {}
 
+  // A harness for the sender built from the whole config, as TCPPeer builds it (adaptive RTO within
+  // rt_timeout_min and rt_timeout_max, congestion control, ...)
+  TCPSenderTestHarness( std::string name, const TCPConfig& config, bool whole_config )
+    : TestHarness( move( name ),
+                   "initial_RTO_ms=" + to_string( config.rt_timeout ) + ", RTO within ["
+                     + to_string( config.rt_timeout_min ) + ", " + to_string( config.rt_timeout_max )
+                     + "] and ISN=" + to_string( config.isn ),
+                   { whole_config ? TCPSender { ByteStream { config.send_capacity, config.send_storage }, config }
+                                  : TCPSender {
+                                    ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
+  {}
+
   template<std::derived_from<TestStep<TCPSender>> T>
   void execute( const T& test )
   {
@@ -104,6 +118,44 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<TCPSender, uint64_
   uint64_t value( const TCPSender& sender ) const override { return sender.consecutive_retransmissions(); }
 };
 
+struct ExpectRTO : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "RTO_ms"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.RTO_ms(); }
+};
+
+struct ExpectMaxPayloadSize : public ExpectNumber<TCPSender, uint16_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "max_payload_size"; }
+  uint16_t value( const TCPSender& sender ) const override { return sender.max_payload_size(); }
+};
+
+struct ExpectSmoothedRTT : public ExpectNumber<TCPSender, std::optional<uint64_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "smoothed_RTT_ms"; }
+  std::optional<uint64_t> value( const TCPSender& sender ) const override { return sender.smoothed_RTT_ms(); }
+};
+
+struct ExpectCongestionWindow : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_window"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.congestion_window(); }
+};
+
+struct ExpectSlowStartThreshold : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_control()->slow_start_threshold()"; }
+  uint64_t value( const TCPSender& sender ) const override
+  {
+    return sender.congestion_control() ? sender.congestion_control()->slow_start_threshold() : UINT64_MAX;
+  }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -122,6 +174,55 @@ struct SetError : public Action<TCPSender>
   void execute( TCPSender& sender ) const override { sender.writer().set_error(); }
 };
 
+// the peer's SYN, with this window-scale option (or none), has arrived
+struct PeerWindowScale : public Action<TCPSender>
+{
+  std::optional<uint8_t> window_scale_ {};
+
+  explicit PeerWindowScale( std::optional<uint8_t> window_scale ) : window_scale_( window_scale ) {}
+  std::string description() const override
+  {
+    return "peer's SYN offers window_scale=" + to_string( window_scale_ );
+  }
+  void execute( TCPSender& sender ) const override { sender.set_peer_window_scale( window_scale_ ); }
+};
+
+// the peer's SYN, with or without SACK-Permitted, has arrived
+struct PeerSackPermitted : public Action<TCPSender>
+{
+  bool sack_permitted_ {};
+
+  explicit PeerSackPermitted( bool sack_permitted ) : sack_permitted_( sack_permitted ) {}
+  std::string description() const override
+  {
+    return std::string { "peer's SYN " } + ( sack_permitted_ ? "carries" : "doesn't carry" ) + " SACK-Permitted";
+  }
+  void execute( TCPSender& sender ) const override { sender.set_peer_sack_permitted( sack_permitted_ ); }
+};
+
+// the peer's SYN, with or without the timestamps option, has arrived
+struct PeerTimestamps : public Action<TCPSender>
+{
+  bool timestamps_ {};
+
+  explicit PeerTimestamps( bool timestamps ) : timestamps_( timestamps ) {}
+  std::string description() const override
+  {
+    return std::string { "peer's SYN " } + ( timestamps_ ? "carries" : "doesn't carry" ) + " timestamps";
+  }
+  void execute( TCPSender& sender ) const override { sender.set_peer_timestamps( timestamps_ ); }
+};
+
+// the peer's SYN, with this MSS option (or none), has arrived
+struct PeerMSS : public Action<TCPSender>
+{
+  std::optional<uint16_t> mss_ {};
+
+  explicit PeerMSS( std::optional<uint16_t> mss ) : mss_( mss ) {}
+  std::string description() const override { return "peer's SYN offers MSS=" + to_string( mss_ ); }
+  void execute( TCPSender& sender ) const override { sender.set_peer_mss( mss_ ); }
+};
+
 struct HasError : public ExpectBool<TCPSender>
 {
   using ExpectBool::ExpectBool;
@@ -222,7 +323,14 @@ struct Receive : public Action<SenderAndOutput>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const SackBlock& block : msg_.sacks() ) {
+      desc << ", sack=[" << to_string( block.begin ) << ", " << to_string( block.end ) << ")";
+    }
+    if ( msg_.timestamp_echo.has_value() ) {
+      desc << ", TSecr=" << msg_.timestamp_echo.value();
+    }
+    desc << ")";
     if ( push_ ) {
       desc << ", then push";
     }
@@ -235,6 +343,19 @@ struct Receive : public Action<SenderAndOutput>
     return *this;
   }
 
+  Receive& with_timestamp_echo( uint32_t echo )
+  {
+    msg_.timestamp_echo = echo;
+    return *this;
+  }
+
+  Receive& with_sack( std::initializer_list<SackBlock> blocks )
+  {
+    std::ranges::copy( blocks, msg_.sack_blocks.begin() );
+    msg_.sack_block_count = static_cast<uint8_t>( blocks.size() );
+    return *this;
+  }
+
   void execute( SenderAndOutput& ss ) const override
   {
     ss.sender.receive( msg_ );
@@ -283,8 +404,16 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
+  std::optional<bool> sack_permitted {};
+  std::optional<std::optional<uint8_t>> window_scale {}; // the window-scale option (or its absence)
+  std::optional<std::optional<uint32_t>> timestamp {};   // TSval (or the absence of the timestamps option)
+  std::optional<std::optional<uint16_t>> mss {};         // the MSS option (or its absence)
 
-  bool empty() const { return not( syn or fin or rst or seqno or data or payload_size ); }
+  bool empty() const
+  {
+    return not( syn or fin or rst or seqno or data or payload_size or sack_permitted or window_scale
+                or timestamp or mss );
+  }
 
   ExpectMessage& with_syn( bool syn_ )
   {
@@ -292,6 +421,30 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     return *this;
   }
 
+  ExpectMessage& with_sack_permitted( bool sack_permitted_ )
+  {
+    sack_permitted = sack_permitted_;
+    return *this;
+  }
+
+  ExpectMessage& with_window_scale( std::optional<uint8_t> window_scale_ )
+  {
+    window_scale = window_scale_;
+    return *this;
+  }
+
+  ExpectMessage& with_mss( std::optional<uint16_t> mss_ )
+  {
+    mss = mss_;
+    return *this;
+  }
+
+  ExpectMessage& with_timestamp( std::optional<uint32_t> timestamp_ )
+  {
+    timestamp = timestamp_;
+    return *this;
+  }
+
   ExpectMessage& with_fin( bool fin_ )
   {
     fin = fin_;
@@ -339,6 +492,18 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( syn.has_value() ) {
       o << ( syn.value() ? " +SYN" : " -SYN" );
     }
+    if ( sack_permitted.has_value() ) {
+      o << ( sack_permitted.value() ? " +SACK_PERM" : " -SACK_PERM" );
+    }
+    if ( window_scale.has_value() ) {
+      o << ( window_scale->has_value() ? " WS=" + std::to_string( window_scale->value() ) : " -WS" );
+    }
+    if ( mss.has_value() ) {
+      o << ( mss->has_value() ? " MSS=" + std::to_string( mss->value() ) : " -MSS" );
+    }
+    if ( timestamp.has_value() ) {
+      o << ( timestamp->has_value() ? " TSval=" + std::to_string( timestamp->value() ) : " -TS" );
+    }
 
     if ( data.has_value() and data.value().size() <= 32 ) {
       o << " payload=\"" << pretty_print( data.value(), 32 ) << "\"";
@@ -377,14 +542,26 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 
     const TCPSenderMessage seg = ss.expect_message();
 
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.sender.max_payload_size() ) {
       throw ExpectationViolation( "sent a message with a " + std::to_string( seg.payload.size() )
                                   + "-byte payload, which is longer than the maximum ("
-                                  + std::to_string( TCPConfig::MAX_PAYLOAD_SIZE ) + ")" );
+                                  + std::to_string( ss.sender.max_payload_size() ) + ")" );
     }
     if ( syn.has_value() and seg.SYN != syn.value() ) {
       throw MessageExpectationViolation( seg, "SYN flag", syn.value(), seg.SYN );
     }
+    if ( sack_permitted.has_value() and seg.SACK_permitted != sack_permitted.value() ) {
+      throw MessageExpectationViolation( seg, "SACK-permitted option", sack_permitted.value(), seg.SACK_permitted );
+    }
+    if ( window_scale.has_value() and seg.window_scale != window_scale.value() ) {
+      throw MessageExpectationViolation( seg, "window-scale option", window_scale.value(), seg.window_scale );
+    }
+    if ( mss.has_value() and seg.max_segment_size != mss.value() ) {
+      throw MessageExpectationViolation( seg, "MSS option", mss.value(), seg.max_segment_size );
+    }
+    if ( timestamp.has_value() and seg.timestamp != timestamp.value() ) {
+      throw MessageExpectationViolation( seg, "TSval", timestamp.value(), seg.timestamp );
+    }
     if ( fin.has_value() and seg.FIN != fin.value() ) {
       throw MessageExpectationViolation( seg, "FIN flag", fin.value(), seg.FIN );
     }
@@ -404,3 +581,25 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 
   constexpr std::string obj() const override { return "TCPSender"; }
 };
+
+/* fixture shared by the tests of whole-window behaviour (congestion control, fast retransmit, SACK) */
+
+inline constexpr uint64_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+inline constexpr uint16_t BIG_WINDOW = 60000;
+
+inline TCPConfig config( CongestionControl::Algorithm algorithm, Wrap32 isn )
+{
+  TCPConfig cfg;
+  cfg.isn = isn;
+  cfg.congestion_control = algorithm;
+  return cfg;
+}
+
+// Connect, then have the peer open a window much bigger than the congestion window
+inline void connect( TCPSenderTestHarness& test, Wrap32 isn, bool sack_permitted = true )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( sack_permitted ).with_seqno( isn ) );
+  test.execute( AckReceived { isn + 1 }.with_win( BIG_WINDOW ) );
+  test.execute( ExpectNoSegment {} );
+}
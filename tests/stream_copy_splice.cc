@@ -0,0 +1,170 @@
+#include "bidirectional_stream_copy.hh"
+
+#include "exception.hh"
+#include "socket.hh"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+// The case being run, for the watchdog's report
+atomic<const char*> current_case { "setup" };
+
+// The relay blocks in poll() and the test's threads in blocking reads and joins, so a stall would hang the test
+// silently: fail it instead, naming the case that stalled
+void start_watchdog( chrono::seconds deadline )
+{
+  thread( [deadline] {
+    this_thread::sleep_for( deadline );
+    cerr << "bidirectional_stream_copy with splice: \"" << current_case.load() << "\" still running after "
+         << deadline.count() << " s (stalled?)\n";
+    _exit( EXIT_FAILURE );
+  } ).detach();
+}
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "bidirectional_stream_copy with splice: expected " + what );
+  }
+}
+
+string random_string( size_t len, size_t seed )
+{
+  default_random_engine rd { seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_CLOEXEC ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+pair<FileDescriptor, FileDescriptor> stream_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// Write all of `data` to a blocking fd
+void write_all( FileDescriptor& fd, string_view data )
+{
+  while ( not data.empty() ) {
+    data.remove_prefix( fd.write( data ) );
+  }
+}
+
+// Read a blocking fd to EOF
+string read_all( FileDescriptor& fd )
+{
+  string received;
+  string buffer;
+  while ( not fd.eof() ) {
+    fd.read( buffer );
+    received += buffer;
+  }
+  return received;
+}
+
+// The relay's peer is one end of a socketpair, and its input and output are pipes. The payloads are several
+// times the relay's pipe (and the socket buffers), so each splice moves only part of what is buffered.
+void relay_through_pipes( size_t outbound_len, size_t inbound_len )
+{
+  current_case = "relay_through_pipes";
+  const string outbound = random_string( outbound_len, outbound_len );
+  const string inbound = random_string( inbound_len, inbound_len + 1 );
+  auto [relay_end, peer] = stream_pair();
+  LocalStreamSocket socket { move( relay_end ) };
+  auto [input, input_writer] = make_pipe();
+  auto [output_reader, output] = make_pipe();
+
+  thread relay( [&] { bidirectional_stream_copy( socket, input, output, "peer", true ); } );
+  thread outbound_writer( [&] {
+    write_all( input_writer, outbound );
+    input_writer.close();
+  } );
+  thread inbound_writer( [&] {
+    write_all( peer, inbound );
+    CheckSystemCall( "shutdown", ::shutdown( peer.fd_num(), SHUT_WR ) );
+  } );
+
+  string output_received;
+  thread output_drain( [&] { output_received = read_all( output_reader ); } );
+  const string peer_received = read_all( peer );
+  output_drain.join();
+  inbound_writer.join();
+  outbound_writer.join();
+  relay.join();
+
+  expect( peer_received == outbound, "the peer to receive the input" );
+  expect( output_received == inbound, "the output to receive what the peer sent" );
+  expect( peer.eof() and output_reader.eof(), "EOF on both sides" );
+}
+
+// splice() into a file opened for appending fails with EINVAL: the inbound direction has to move what is
+// already in its pipe into the ByteStream and copy from then on
+void fall_back_to_copying( size_t inbound_len )
+{
+  current_case = "fall_back_to_copying";
+  const string inbound = random_string( inbound_len, inbound_len + 2 );
+  auto [relay_end, peer] = stream_pair();
+  LocalStreamSocket socket { move( relay_end ) };
+  auto [input, input_writer] = make_pipe();
+  input_writer.close();
+
+  array<char, 32> name { "/tmp/stream_copy_splice.XXXXXX" };
+  FileDescriptor file { CheckSystemCall( "mkstemp", ::mkstemp( name.data() ) ) };
+  FileDescriptor output { CheckSystemCall( "open", ::open( name.data(), O_WRONLY | O_APPEND | O_CLOEXEC ) ) };
+  CheckSystemCall( "unlink", ::unlink( name.data() ) );
+
+  thread relay( [&] { bidirectional_stream_copy( socket, input, output, "peer", true ); } );
+  write_all( peer, inbound );
+  CheckSystemCall( "shutdown", ::shutdown( peer.fd_num(), SHUT_WR ) );
+  const string peer_received = read_all( peer );
+  relay.join();
+
+  CheckSystemCall( "lseek", ::lseek( file.fd_num(), 0, SEEK_SET ) );
+  expect( read_all( file ) == inbound, "the output file to hold what the peer sent" );
+  expect( peer_received.empty() and peer.eof(), "EOF (and nothing else) at the peer" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    start_watchdog( chrono::seconds { 90 } );
+    relay_through_pipes( 8'000'000, 3'000'000 );
+    relay_through_pipes( 1, 0 );
+    relay_through_pipes( 0, 0 );
+    fall_back_to_copying( 3'000'000 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
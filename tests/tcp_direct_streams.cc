@@ -0,0 +1,210 @@
+#include "tcp_minnow_socket_impl.hh"
+
+#include "eventloop.hh"
+#include "exception.hh"
+#include "helpers.hh"
+#include "spsc_byte_stream.hh"
+
+#include <array>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// Carries IPv4 datagrams over one end of a Unix-domain socketpair, so that two TCPMinnowSockets can talk
+// to each other without a tun device
+class SocketPairAdapter : public TCPOverIPv4Adapter
+{
+  FileDescriptor fd_;
+
+public:
+  explicit SocketPairAdapter( FileDescriptor&& fd ) : fd_( move( fd ) ) {}
+
+  optional<TCPMessage> read()
+  {
+    vector<string> strs( 1 );
+    fd_.read( strs.front() );
+
+    InternetDatagram ip_dgram;
+    if ( parse( ip_dgram, move( strs ) ) ) {
+      return unwrap_tcp_in_ip( move( ip_dgram ) );
+    }
+    return {};
+  }
+
+  void write( const TCPMessage& seg ) { fd_.write( serialize( wrap_tcp_in_ip( seg ) ) ); }
+
+  FileDescriptor& fd() { return fd_; }
+};
+
+static_assert( TCPDatagramAdapter<SocketPairAdapter> );
+
+using DirectSocket = TCPMinnowSocket<SocketPairAdapter>;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "TCPMinnowSocket direct streams: expected " + what );
+  }
+}
+
+string random_string( size_t len, size_t seed )
+{
+  default_random_engine rd { seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// The owner's side of the outbound stream: push all of `data` (unless it has an error), then close it
+void send_all( SPSCByteStream& stream, string_view data )
+{
+  EventLoop eventloop {};
+  eventloop.add_rule(
+    "push to TCPPeer",
+    stream.writable_fd(),
+    Direction::In,
+    [&] {
+      stream.writable_fd().clear();
+      while ( not data.empty() and stream.writer().available_capacity() > 0 ) {
+        data.remove_prefix( stream.writer().push( data ) );
+      }
+      if ( data.empty() or stream.has_error() ) {
+        stream.writer().close();
+      }
+    },
+    [&] { return not stream.writer().is_closed(); } );
+  while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+}
+
+// The owner's side of the inbound stream: read until it is finished or has an error
+string receive_all( SPSCByteStream& stream )
+{
+  string received;
+  EventLoop eventloop {};
+  eventloop.add_rule(
+    "pop from TCPPeer",
+    stream.readable_fd(),
+    Direction::In,
+    [&] {
+      stream.readable_fd().clear();
+      while ( stream.reader().bytes_buffered() ) {
+        const string_view peeked = stream.reader().peek();
+        received += peeked;
+        stream.reader().pop( peeked.size() );
+      }
+    },
+    [&] { return not stream.reader().is_finished() and not stream.has_error(); } );
+  while ( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+  return received;
+}
+
+struct Connection
+{
+  DirectSocket client;
+  DirectSocket server;
+  TCPConfig config {};
+  FdAdapterConfig client_addresses {};
+  FdAdapterConfig server_addresses {};
+
+  Connection( pair<FileDescriptor, FileDescriptor> fds, uint64_t capacity )
+    : client( SocketPairAdapter { move( fds.first ) } ), server( SocketPairAdapter { move( fds.second ) } )
+  {
+    client.use_direct_streams( capacity );
+    server.use_direct_streams( capacity );
+    config.rt_timeout = 100; // the client lingers for 10 * rt_timeout after both streams finish
+    client_addresses.source = Address { "10.144.0.1", 1111 };
+    client_addresses.destination = Address { "10.144.0.2", 2222 };
+    server_addresses.source = Address { "10.144.0.2", 2222 };
+  }
+};
+
+pair<FileDescriptor, FileDescriptor> datagram_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// Each owner thread writes its whole payload, closes its outbound stream and reads the peer's to the end
+void transfer( size_t request_len, size_t reply_len, uint64_t capacity )
+{
+  const string request = random_string( request_len, request_len );
+  const string reply = random_string( reply_len, reply_len + 1 );
+  Connection c { datagram_pair(), capacity };
+
+  string server_received;
+  thread server_owner( [&] {
+    c.server.listen_and_accept( c.config, c.server_addresses );
+    server_received = receive_all( c.server.direct_inbound() );
+    send_all( c.server.direct_outbound(), reply );
+    c.server.wait_until_closed();
+  } );
+
+  c.client.connect( c.config, c.client_addresses );
+  send_all( c.client.direct_outbound(), request );
+  const string client_received = receive_all( c.client.direct_inbound() );
+  c.client.wait_until_closed();
+  server_owner.join();
+
+  expect( server_received == request, "the server to read the bytes the client wrote" );
+  expect( client_received == reply, "the client to read the bytes the server wrote" );
+  expect( not c.server.direct_inbound().has_error(), "no error on the server's inbound stream" );
+  expect( not c.client.direct_inbound().has_error(), "no error on the client's inbound stream" );
+  expect( c.client.direct_inbound().reader().is_finished(), "the client's inbound stream to be finished" );
+}
+
+// An error the owner sets on its outbound stream resets the connection, and both owners see an error inbound
+void error()
+{
+  Connection c { datagram_pair(), 4096 };
+
+  string server_received;
+  thread server_owner( [&] {
+    c.server.listen_and_accept( c.config, c.server_addresses );
+    server_received = receive_all( c.server.direct_inbound() );
+    c.server.wait_until_closed();
+  } );
+
+  c.client.connect( c.config, c.client_addresses );
+  SPSCByteStream& outbound = c.client.direct_outbound();
+  expect( outbound.writer().push( "hello" ) == 5, "the push to the outbound stream to succeed" );
+  outbound.set_error();
+  receive_all( c.client.direct_inbound() );
+  c.client.wait_until_closed();
+  server_owner.join();
+
+  expect( c.server.direct_inbound().has_error(), "the reset to reach the server's owner as an error" );
+  expect( c.client.direct_inbound().has_error(), "the client's owner to see an error inbound" );
+  expect( server_received.size() <= 5, "no more bytes than were written before the error" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    transfer( 1'000'000, 100'000, 65536 );
+    transfer( 5000, 1, 1 );
+    transfer( 0, 0, 4096 );
+    error();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+#include "checksum.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+string serialize( const TCPSegment& seg )
+{
+  Serializer serializer;
+  seg.serialize( serializer );
+  string ret;
+  for ( const auto& buf : serializer.finish() ) {
+    ret += buf.get();
+  }
+  return ret;
+}
+
+// Parse `bytes` as a TCP segment (with a zero pseudo-header checksum); returns whether it parsed
+bool parse( const string& bytes, TCPSegment& seg )
+{
+  vector<string> buffers { bytes };
+  Parser parser { buffers };
+  seg.parse( parser, 0 );
+  return not parser.has_error();
+}
+
+// Serialize with a correct checksum, then parse the result back
+TCPSegment roundtrip( TCPSegment seg )
+{
+  seg.compute_checksum( 0 );
+  TCPSegment ret;
+  if ( not parse( serialize( seg ), ret ) ) {
+    throw runtime_error( "segment didn't parse: " + seg.to_string() );
+  }
+  return ret;
+}
+
+// A header with the given options (padded to a multiple of 4 bytes) and payload, with a correct checksum
+string raw_segment( const string& options, const string& payload )
+{
+  string header( TCPSegment::HEADER_LENGTH, '\0' );
+  const size_t header_length = TCPSegment::HEADER_LENGTH + ( options.size() + 3 ) / 4 * 4;
+  header[12] = static_cast<char>( ( header_length / 4 ) << 4 ); // data offset
+  header[13] = 0b0001'0000;                                     // ACK
+  string ret = header + options + string( header_length - TCPSegment::HEADER_LENGTH - options.size(), '\0' );
+  ret += payload;
+
+  InternetChecksum check;
+  check.add( string_view { ret } );
+  const uint16_t cksum = check.value();
+  ret[16] = static_cast<char>( cksum >> 8 );
+  ret[17] = static_cast<char>( cksum & 0xff );
+  return ret;
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      // no options: a bare 20-byte header
+      TCPSegment seg;
+      seg.message.sender->payload = "hello";
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 5 } );
+    }
+
+    {
+      TCPSegment seg;
+      seg.message.sender->SYN = true;
+      seg.message.sender->SACK_permitted = true;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 4 } );
+      const TCPSegment parsed = roundtrip( seg );
+      test_should_be( parsed.message.sender->SYN, true );
+      test_should_be( parsed.message.sender->SACK_permitted, true );
+      test_should_be( parsed.message.receiver->sack_block_count, uint8_t { 0 } );
+    }
+
+    {
+      // SACK-permitted only goes on a SYN
+      TCPSegment seg;
+      seg.message.sender->SACK_permitted = true;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH } );
+    }
+
+    {
+      TCPSegment seg;
+      seg.message.sender->SYN = true;
+      seg.message.sender->window_scale = 7;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 4 } );
+      const TCPSegment parsed = roundtrip( seg );
+      test_should_be( parsed.message.sender->window_scale.has_value(), true );
+      test_should_be( parsed.message.sender->window_scale.value(), uint8_t { 7 } );
+      test_should_be( parsed.message.sender->SACK_permitted, false );
+
+      // a shift of zero is still an offer to scale
+      seg.message.sender->window_scale = 0;
+      seg.message.sender->SACK_permitted = true;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 8 } );
+      const TCPSegment both = roundtrip( seg );
+      test_should_be( both.message.sender->window_scale.has_value(), true );
+      test_should_be( both.message.sender->window_scale.value(), uint8_t { 0 } );
+      test_should_be( both.message.sender->SACK_permitted, true );
+    }
+
+    {
+      TCPSegment seg;
+      seg.message.sender->SYN = true;
+      seg.message.sender->max_segment_size = 8960;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 4 } );
+      test_should_be( roundtrip( seg ).message.sender->max_segment_size.value(), uint16_t { 8960 } );
+
+      // every option a SYN can carry
+      seg.message.sender->window_scale = 7;
+      seg.message.sender->SACK_permitted = true;
+      seg.message.sender->timestamp = 1;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 24 } );
+      const TCPSegment parsed = roundtrip( seg );
+      test_should_be( parsed.message.sender->max_segment_size.value(), uint16_t { 8960 } );
+      test_should_be( parsed.message.sender->window_scale.value(), uint8_t { 7 } );
+      test_should_be( parsed.message.sender->SACK_permitted, true );
+      test_should_be( parsed.message.sender->timestamp.value(), uint32_t { 1 } );
+
+      // the MSS only goes on a SYN
+      seg.message.sender->SYN = false;
+      test_should_be( roundtrip( seg ).message.sender->max_segment_size.has_value(), false );
+    }
+
+    {
+      // the window scale only goes on a SYN, and a SYN without it doesn't offer to scale
+      TCPSegment seg;
+      seg.message.sender->window_scale = 3;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH } );
+      test_should_be( roundtrip( seg ).message.sender->window_scale.has_value(), false );
+    }
+
+    {
+      TCPSegment seg;
+      seg.message.receiver->ackno = Wrap32 { 1000 };
+      seg.message.receiver->window_size = 4321;
+      seg.message.receiver->sack_blocks = { SackBlock { Wrap32 { 3000 }, Wrap32 { 4000 } },
+                                            SackBlock { Wrap32 { UINT32_MAX - 10 }, Wrap32 { 20 } },
+                                            SackBlock { Wrap32 { 1500 }, Wrap32 { 2000 } } };
+      seg.message.receiver->sack_block_count = 3;
+      seg.message.sender->payload = "payload after the options";
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 4 + 3 * 8 + 25 } );
+
+      const TCPSegment parsed = roundtrip( seg );
+      test_should_be( parsed.message.receiver->ackno.value(), Wrap32 { 1000 } );
+      test_should_be( parsed.message.receiver->window_size, uint16_t { 4321 } );
+      test_should_be( parsed.message.receiver->sack_block_count, uint8_t { 3 } );
+      for ( size_t i = 0; i < 3; i++ ) {
+        test_should_be( parsed.message.receiver->sack_blocks.at( i ).begin,
+                        seg.message.receiver->sack_blocks.at( i ).begin );
+        test_should_be( parsed.message.receiver->sack_blocks.at( i ).end,
+                        seg.message.receiver->sack_blocks.at( i ).end );
+      }
+      test_should_be( parsed.message.sender->payload == "payload after the options", true );
+    }
+
+    {
+      // SACK blocks without an ackno aren't sent
+      TCPSegment seg;
+      seg.message.receiver->sack_block_count = 1;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH } );
+    }
+
+    {
+      TCPSegment seg;
+      seg.message.sender->SYN = true;
+      seg.message.sender->timestamp = 0xdeadbeef;
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 12 } );
+      const TCPSegment parsed = roundtrip( seg );
+      test_should_be( parsed.message.sender->timestamp.value(), uint32_t { 0xdeadbeef } );
+      // without an ACK, TSecr isn't meaningful (and is sent as zero)
+      test_should_be( parsed.message.receiver->timestamp_echo.has_value(), false );
+
+      seg.message.receiver->ackno = Wrap32 { 77 };
+      seg.message.receiver->timestamp_echo = 12345;
+      const TCPSegment acked = roundtrip( seg );
+      test_should_be( acked.message.sender->timestamp.value(), uint32_t { 0xdeadbeef } );
+      test_should_be( acked.message.receiver->timestamp_echo.value(), uint32_t { 12345 } );
+    }
+
+    {
+      // with timestamps, only three SACK blocks fit in the 40 bytes of options
+      TCPSegment seg;
+      seg.message.sender->timestamp = 1;
+      seg.message.receiver->ackno = Wrap32 { 1000 };
+      seg.message.receiver->timestamp_echo = 2;
+      for ( uint32_t i = 0; i < TCPReceiverMessage::MAX_SACK_BLOCKS; i++ ) {
+        seg.message.receiver->sack_blocks.at( i ) = { Wrap32 { 2000 + 100 * i }, Wrap32 { 2050 + 100 * i } };
+      }
+      seg.message.receiver->sack_block_count = static_cast<uint8_t>( TCPReceiverMessage::MAX_SACK_BLOCKS );
+      test_should_be( serialize( seg ).size(), size_t { TCPSegment::HEADER_LENGTH + 40 } );
+      const TCPSegment parsed = roundtrip( seg );
+      test_should_be( parsed.message.receiver->sack_block_count, uint8_t { 3 } );
+      test_should_be( parsed.message.receiver->sack_blocks.at( 2 ).begin, Wrap32 { 2200 } );
+      test_should_be( parsed.message.receiver->timestamp_echo.value(), uint32_t { 2 } );
+      // and only those are printed
+      test_should_be( seg.to_string().find( "SACK<2200-2250>" ) != string::npos, true );
+      test_should_be( seg.to_string().find( "SACK<2300-2350>" ) != string::npos, false );
+    }
+
+    {
+      // unknown options are skipped, and everything after END is padding
+      const string options { "\x02\x04\x05\xb4"                         // MSS 1460
+                             "\x01"                                     // NOP
+                             "\x08\x0a\x00\x00\x00\x01\x00\x00\x00\x02" // timestamps
+                             "\x04\x02"                                 // SACK permitted
+                             "\x00\x05\x0a",                            // END, then junk
+                             20 };
+      TCPSegment seg;
+      test_should_be( parse( raw_segment( options, "data" ), seg ), true );
+      test_should_be( seg.message.sender->SACK_permitted, true );
+      test_should_be( seg.message.receiver->sack_block_count, uint8_t { 0 } );
+      test_should_be( seg.message.sender->payload == "data", true );
+    }
+
+    {
+      // the most SACK blocks that fit in the header
+      string options { "\x01\x01\x05\x22", 4 };
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        for ( const uint32_t edge : { 100 * i, 100 * i + 50 } ) {
+          options += static_cast<char>( edge >> 24 );
+          options += static_cast<char>( edge >> 16 );
+          options += static_cast<char>( edge >> 8 );
+          options += static_cast<char>( edge );
+        }
+      }
+      TCPSegment seg;
+      test_should_be( parse( raw_segment( options, "" ), seg ), true );
+      test_should_be( seg.message.receiver->sack_block_count, uint8_t { TCPReceiverMessage::MAX_SACK_BLOCKS } );
+      test_should_be( seg.message.receiver->sack_blocks.at( 3 ).begin, Wrap32 { 300 } );
+      test_should_be( seg.message.receiver->sack_blocks.at( 3 ).end, Wrap32 { 350 } );
+    }
+
+    {
+      // malformed options: a zero length, and a length that runs past the header
+      TCPSegment seg;
+      test_should_be( parse( raw_segment( string { "\x08\x00", 2 }, "" ), seg ), false );
+      TCPSegment seg2;
+      test_should_be( parse( raw_segment( string { "\x01\x01\x08\x0a", 4 }, "" ), seg2 ), false );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
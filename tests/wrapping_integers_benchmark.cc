@@ -0,0 +1,144 @@
+#include "benchmark_common.hh"
+#include "wrapping_integers.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+struct Result
+{
+  string method;      // "scalar" (one unwrap() call per seqno) or "batch" (one call per array)
+  size_t batch_size;  // seqnos unwrapped per call to the batch unwrap
+  uint64_t seqnos;    // seqnos unwrapped in total
+  double seconds;     // wall-clock time to unwrap them
+  uint64_t checksum;  // sum of the absolute sequence numbers (so the work can't be optimized away)
+
+  double nanoseconds_per_seqno() const { return seconds * 1e9 / static_cast<double>( seqnos ); }
+};
+
+// Seqnos scattered within a window of `spread` around the absolute sequence number `center`
+vector<Wrap32> make_seqnos( size_t count, Wrap32 zero_point, uint64_t center, uint32_t spread )
+{
+  default_random_engine rd { 1982 };
+  uniform_int_distribution<uint32_t> ud { 0, spread };
+  vector<Wrap32> seqnos;
+  seqnos.reserve( count );
+  for ( size_t i = 0; i < count; ++i ) {
+    seqnos.push_back( Wrap32::wrap( center - spread / 2 + ud( rd ), zero_point ) );
+  }
+  return seqnos;
+}
+
+Result run_scalar( span<const Wrap32> seqnos, Wrap32 zero_point, uint64_t checkpoint, size_t rounds )
+{
+  uint64_t checksum = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t round = 0; round < rounds; ++round ) {
+    for ( const Wrap32 seqno : seqnos ) {
+      checksum += seqno.unwrap( zero_point, checkpoint );
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  return { "scalar",
+           1,
+           seqnos.size() * rounds,
+           duration_cast<duration<double>>( stop_time - start_time ).count(),
+           checksum };
+}
+
+Result run_batch( span<const Wrap32> seqnos,
+                  Wrap32 zero_point,
+                  uint64_t checkpoint,
+                  size_t rounds,
+                  size_t batch_size )
+{
+  vector<uint64_t> absolute( batch_size );
+  uint64_t checksum = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t round = 0; round < rounds; ++round ) {
+    for ( size_t i = 0; i < seqnos.size(); i += batch_size ) {
+      const size_t n = min( batch_size, seqnos.size() - i );
+      Wrap32::unwrap( seqnos.subspan( i, n ), zero_point, checkpoint, span( absolute ).first( n ) );
+      for ( size_t j = 0; j < n; ++j ) {
+        checksum += absolute[j];
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  return { "batch",
+           batch_size,
+           seqnos.size() * rounds,
+           duration_cast<duration<double>>( stop_time - start_time ).count(),
+           checksum };
+}
+
+void print_table_row( const Result& r )
+{
+  cout << left << setw( 10 ) << r.method << right << setw( 8 ) << r.batch_size << fixed << setprecision( 3 )
+       << setw( 10 ) << r.nanoseconds_per_seqno() << "\n";
+}
+
+benchmark::Fields fields( const Result& r )
+{
+  return { benchmark::field( "method", r.method ),
+           benchmark::field( "batch_size", r.batch_size ),
+           benchmark::field( "seqnos", r.seqnos ),
+           benchmark::field( "ns_per_seqno", r.nanoseconds_per_seqno() ) };
+}
+
+void program_body( span<char*> args )
+{
+  const benchmark::Options options
+    = benchmark::parse_options( args, { "seqnos", 100'000'000, "Unwrap <n> seqnos with each method" } );
+
+  // A window's worth of seqnos (as in a retransmission queue or a batch of SACK blocks) straddling a wrap
+  constexpr size_t window = 4096;
+  const Wrap32 zero_point { 0xfff0'0000 };
+  const uint64_t checkpoint = ( uint64_t { 3 } << 32 ) + 0x0010'0000;
+  const vector<Wrap32> seqnos = make_seqnos( window, zero_point, checkpoint, 1 << 24 );
+  const size_t rounds = max( size_t { 1 }, options.size / window );
+
+  cout << left << setw( 10 ) << "method" << right << setw( 8 ) << "batch" << setw( 10 ) << "ns/seqno"
+       << "\n";
+
+  vector<Result> results;
+  results.push_back( run_scalar( seqnos, zero_point, checkpoint, rounds ) );
+  print_table_row( results.back() );
+  for ( const size_t batch_size : { 8UL, 64UL, 512UL, window } ) {
+    results.push_back( run_batch( seqnos, zero_point, checkpoint, rounds, batch_size ) );
+    print_table_row( results.back() );
+  }
+
+  for ( const Result& r : results ) {
+    if ( r.checksum != results.front().checksum ) {
+      throw runtime_error( "batch unwrap (" + to_string( r.batch_size ) + ") disagrees with scalar unwrap" );
+    }
+  }
+
+  benchmark::write_results( options, "wrapping_integers", {}, results, fields );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    program_body( span( argv, argc ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
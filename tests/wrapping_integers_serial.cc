@@ -0,0 +1,120 @@
+#include "random.hh"
+#include "test_should_be.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr uint64_t TWO31 = uint64_t { 1 } << 31;
+constexpr uint64_t TWO32 = uint64_t { 1 } << 32;
+
+// Reference unwrap: try the candidates in the checkpoint's 2^32-sized block and the blocks on either side
+uint64_t reference_unwrap( Wrap32 seqno, Wrap32 zero_point, uint64_t checkpoint )
+{
+  const uint64_t offset = Wrap32::distance( zero_point, seqno );
+  const uint64_t block = checkpoint & ~( TWO32 - 1 );
+  uint64_t best = 0;
+  uint64_t best_distance = UINT64_MAX;
+  for ( const uint64_t base : { block - TWO32, block, block + TWO32 } ) {
+    if ( base == block - TWO32 and block == 0 ) {
+      continue; // would be negative
+    }
+    const uint64_t candidate = base + offset;
+    const uint64_t distance = candidate > checkpoint ? candidate - checkpoint : checkpoint - candidate;
+    if ( distance < best_distance or ( distance == best_distance and candidate < best ) ) {
+      best = candidate;
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+// Values on and around the wrap points of a 32-bit sequence number
+vector<uint32_t> boundary_values()
+{
+  vector<uint32_t> values;
+  for ( const uint64_t center : { uint64_t { 0 }, TWO31, TWO32 } ) {
+    for ( uint64_t i = center - 256; i != center + 256; ++i ) {
+      values.push_back( static_cast<uint32_t>( i ) );
+    }
+  }
+  return values;
+}
+
+void test_comparisons()
+{
+  // Every ordered pair around the boundaries, against the definition in terms of forward distance
+  const vector<uint32_t> values = boundary_values();
+  for ( const uint32_t a : values ) {
+    for ( const uint32_t b : values ) {
+      const uint32_t forward = b - a;
+      const bool less = forward != 0 and forward < TWO31;
+      const bool greater = forward > TWO31;
+      test_should_be( Wrap32 { a } < Wrap32 { b }, less );
+      test_should_be( Wrap32 { a } > Wrap32 { b }, greater );
+      test_should_be( Wrap32 { a } <= Wrap32 { b }, less or a == b );
+      test_should_be( Wrap32 { a } >= Wrap32 { b }, greater or a == b );
+      test_should_be( Wrap32::distance( Wrap32 { a }, Wrap32 { b } ) == forward, true );
+      test_should_be( static_cast<uint32_t>( Wrap32 { b } - Wrap32 { a } ) == forward, true );
+    }
+  }
+
+  // Exactly 2^31 apart: neither is before the other
+  test_should_be( Wrap32 { 5 } < Wrap32 { 5 + TWO31 }, false );
+  test_should_be( Wrap32 { 5 + TWO31 } < Wrap32 { 5 }, false );
+
+  // Usable at compile time
+  static_assert( Wrap32 { UINT32_MAX } < Wrap32 { 0 } );
+  static_assert( Wrap32 { 3 } - Wrap32 { UINT32_MAX } == 4 );
+  static_assert( Wrap32::distance( Wrap32 { 10 }, Wrap32 { 9 } ) == UINT32_MAX );
+}
+
+void test_unwrap()
+{
+  auto rd = get_random_engine();
+  const vector<uint32_t> values = boundary_values();
+
+  // Checkpoints around the first few multiples of 2^31, with zero points on and off the boundaries
+  vector<uint64_t> checkpoints;
+  for ( uint64_t center = 0; center <= 4 * TWO32; center += TWO31 ) {
+    for ( uint64_t i = center < 64 ? 0 : center - 64; i < center + 64; ++i ) {
+      checkpoints.push_back( i );
+    }
+  }
+  const array<uint32_t, 5> zero_points { 0, 1, uint32_t { TWO31 }, UINT32_MAX, static_cast<uint32_t>( rd() ) };
+  for ( const uint32_t zero : zero_points ) {
+    vector<Wrap32> seqnos;
+    for ( const uint32_t v : values ) {
+      seqnos.emplace_back( v );
+    }
+    vector<uint64_t> batch( seqnos.size() );
+    for ( const uint64_t checkpoint : checkpoints ) {
+      Wrap32::unwrap( seqnos, Wrap32 { zero }, checkpoint, batch );
+      for ( size_t i = 0; i < seqnos.size(); ++i ) {
+        const uint64_t expected = reference_unwrap( seqnos[i], Wrap32 { zero }, checkpoint );
+        test_should_be( seqnos[i].unwrap( Wrap32 { zero }, checkpoint ), expected );
+        test_should_be( batch[i], expected );
+      }
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_comparisons();
+    test_unwrap();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "buffer_pool.hh"
+
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t kSizeClasses = BufferPool::kBlockSizes.size();
+constexpr size_t kSlabSize = 1 << 20;                               // blocks are carved out of 1 MiB slabs
+constexpr array<size_t, kSizeClasses> kMaxCachedBlocks { 256, 16 }; // per thread: 512 KiB and 1 MiB
+static_assert( kSlabSize % BufferPool::kBlockSizes.back() == 0 );
+
+// The blocks that aren't in any thread's cache, and the slabs they come from (never returned to the OS)
+struct Depot
+{
+  mutex lock {};
+  array<vector<void*>, kSizeClasses> free_blocks {};
+  array<vector<void*>, kSizeClasses> slabs {};
+};
+
+// Never destroyed, so that thread caches can still give their blocks back while the program exits
+Depot& depot()
+{
+  static Depot* const the_depot = new Depot; // NOLINT(*-owning-memory)
+  return *the_depot;
+}
+
+// Hand blocks straight to the depot (once the thread's cache is gone)
+void return_to_depot( void* block, size_t size_class )
+{
+  Depot& d = depot();
+  const lock_guard guard { d.lock };
+  d.free_blocks[size_class].push_back( block );
+}
+
+// Set when this thread's cache has been destroyed, for blocks freed later by other thread_local destructors
+thread_local bool thread_cache_destroyed = false;
+
+// Each thread's free blocks
+class ThreadCache
+{
+  array<vector<void*>, kSizeClasses> free_blocks_ {};
+
+  // Take up to half a cache's worth of blocks from the depot, carving a new slab if it has none
+  void refill( size_t size_class )
+  {
+    Depot& d = depot();
+    const lock_guard guard { d.lock };
+    vector<void*>& shared = d.free_blocks[size_class];
+    if ( shared.empty() ) {
+      char* const slab = static_cast<char*>( ::operator new( kSlabSize ) );
+      d.slabs[size_class].push_back( slab );
+      const size_t block_size = BufferPool::kBlockSizes[size_class];
+      for ( size_t offset = 0; offset < kSlabSize; offset += block_size ) {
+        shared.push_back( slab + offset );
+      }
+    }
+    const size_t count = min( shared.size(), kMaxCachedBlocks[size_class] / 2 );
+    free_blocks_[size_class].insert( free_blocks_[size_class].end(), shared.end() - count, shared.end() );
+    shared.resize( shared.size() - count );
+  }
+
+  // Give the `count` most recently freed blocks of a size class back to the depot
+  void drain( size_t size_class, size_t count )
+  {
+    vector<void*>& local = free_blocks_[size_class];
+    Depot& d = depot();
+    const lock_guard guard { d.lock };
+    d.free_blocks[size_class].insert( d.free_blocks[size_class].end(), local.end() - count, local.end() );
+    local.resize( local.size() - count );
+  }
+
+public:
+  ThreadCache() = default;
+  ThreadCache( const ThreadCache& other ) = delete;
+  ThreadCache& operator=( const ThreadCache& other ) = delete;
+  ThreadCache( ThreadCache&& other ) = delete;
+  ThreadCache& operator=( ThreadCache&& other ) = delete;
+
+  ~ThreadCache()
+  {
+    thread_cache_destroyed = true;
+    for ( size_t size_class = 0; size_class < kSizeClasses; ++size_class ) {
+      drain( size_class, free_blocks_[size_class].size() );
+    }
+  }
+
+  void* allocate( size_t size_class )
+  {
+    vector<void*>& local = free_blocks_[size_class];
+    if ( local.empty() ) {
+      refill( size_class );
+    }
+    void* const block = local.back();
+    local.pop_back();
+    return block;
+  }
+
+  void deallocate( void* block, size_t size_class )
+  {
+    vector<void*>& local = free_blocks_[size_class];
+    local.push_back( block );
+    if ( local.size() > kMaxCachedBlocks[size_class] ) {
+      drain( size_class, local.size() / 2 );
+    }
+  }
+};
+
+ThreadCache& thread_cache()
+{
+  thread_local ThreadCache cache;
+  return cache;
+}
+} // namespace
+
+int BufferPool::size_class( size_t size )
+{
+  for ( size_t i = 0; i < kSizeClasses; ++i ) {
+    if ( size <= kBlockSizes[i] ) {
+      // a smaller request would waste more than half of the (fixed-size) block
+      return size > kBlockSizes[i] / 2 ? static_cast<int>( i ) : -1;
+    }
+  }
+  return -1;
+}
+
+void* BufferPool::allocate( int size_class )
+{
+  return thread_cache().allocate( size_class );
+}
+
+void BufferPool::deallocate( void* block, int size_class )
+{
+  if ( thread_cache_destroyed ) {
+    return_to_depot( block, size_class );
+    return;
+  }
+  thread_cache().deallocate( block, size_class );
+}
+
+uint64_t BufferPool::slab_count( int size_class )
+{
+  Depot& d = depot();
+  const lock_guard guard { d.lock };
+  return d.slabs.at( size_class ).size();
+}
+
+Buffer::Buffer( size_t size )
+{
+  const size_t total_size = kHeaderSize + size;
+  const int size_class = BufferPool::size_class( total_size );
+  void* const memory = size_class < 0 ? ::operator new( total_size ) : BufferPool::allocate( size_class );
+  header_ = new ( memory ) Header { 1, static_cast<uint32_t>( size ), size_class };
+}
+
+void Buffer::release()
+{
+  if ( header_ and header_->refcount.fetch_sub( 1, memory_order_acq_rel ) == 1 ) {
+    const int size_class = header_->size_class;
+    header_->~Header();
+    if ( size_class < 0 ) {
+      ::operator delete( header_ );
+    } else {
+      BufferPool::deallocate( header_, size_class );
+    }
+  }
+  header_ = nullptr;
+}
+
+Buffer::Buffer( const Buffer& other ) noexcept : header_( other.header_ )
+{
+  if ( header_ ) {
+    header_->refcount.fetch_add( 1, memory_order_relaxed );
+  }
+}
+
+Buffer& Buffer::operator=( const Buffer& other ) noexcept
+{
+  if ( this != &other ) {
+    Buffer copy { other };
+    *this = move( copy );
+  }
+  return *this;
+}
+
+Buffer::Buffer( Buffer&& other ) noexcept : header_( exchange( other.header_, nullptr ) ) {}
+
+Buffer& Buffer::operator=( Buffer&& other ) noexcept
+{
+  if ( this != &other ) {
+    release();
+    header_ = exchange( other.header_, nullptr );
+  }
+  return *this;
+}
+
+char* Buffer::data()
+{
+  return header_ ? reinterpret_cast<char*>( header_ ) + kHeaderSize : nullptr; // NOLINT(*-reinterpret-cast)
+}
+
+const char* Buffer::data() const
+{
+  return header_ ? reinterpret_cast<const char*>( header_ ) + kHeaderSize : nullptr; // NOLINT(*-reinterpret-cast)
+}
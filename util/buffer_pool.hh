@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <string>
+#include <vector>
+
+//! Fixed-size blocks (2 KiB for packets, 64 KiB for stream buffers) carved out of large slabs and recycled
+//! through per-thread free lists, so that the many same-sized buffers of many connections don't go through
+//! malloc one by one. Blocks freed by a thread go back to that thread's cache; a cache that grows too big
+//! hands half of its blocks to a shared depot, which refills caches that run dry.
+class BufferPool
+{
+public:
+  static constexpr std::array<size_t, 2> kBlockSizes { 2048, 65536 };
+
+  //! The index into kBlockSizes of the block that serves a request of `size` bytes, or -1 if the request
+  //! should go to the heap (requests that would use less than half a block, or more than the largest one)
+  static int size_class( size_t size );
+
+  //! A block of kBlockSizes[size_class] bytes
+  static void* allocate( int size_class );
+
+  //! Return a block from allocate( size_class ), from any thread
+  static void deallocate( void* block, int size_class );
+
+  //! Number of slabs carved so far for each block size (for tests and statistics)
+  static uint64_t slab_count( int size_class );
+};
+
+//! A refcounted handle to a pool block (or a heap allocation, for sizes the pool doesn't serve).
+//! Copies share the same bytes; the memory goes back to the pool when the last handle is destroyed.
+class Buffer
+{
+  struct Header
+  {
+    std::atomic<uint32_t> refcount;
+    uint32_t size;
+    int size_class;
+  };
+
+  static constexpr size_t kHeaderSize = 16; //!< sizeof( Header ), rounded up to keep data() aligned
+  static_assert( sizeof( Header ) <= kHeaderSize );
+
+  Header* header_ {};
+
+  void release();
+
+public:
+  //! The largest Buffer that still comes from the pool
+  static constexpr size_t kMaxPooledSize = BufferPool::kBlockSizes.back() - kHeaderSize;
+
+  //! An empty buffer with no storage
+  Buffer() = default;
+
+  //! A buffer of `size` (uninitialized) bytes
+  explicit Buffer( size_t size );
+
+  ~Buffer() { release(); }
+  Buffer( const Buffer& other ) noexcept;
+  Buffer& operator=( const Buffer& other ) noexcept;
+  Buffer( Buffer&& other ) noexcept;
+  Buffer& operator=( Buffer&& other ) noexcept;
+
+  char* data();
+  const char* data() const;
+  size_t size() const { return header_ ? header_->size : 0; }
+  std::span<char> span() { return { data(), size() }; }
+  uint32_t use_count() const { return header_ ? header_->refcount.load( std::memory_order_relaxed ) : 0; }
+};
+
+//! A standard allocator that takes its memory from the BufferPool when the size suits one of its blocks
+template<typename T>
+class PoolAllocator
+{
+public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template<typename U>
+  PoolAllocator( const PoolAllocator<U>& /* other */ ) noexcept // NOLINT(*-explicit-*)
+  {}
+
+  T* allocate( size_t n )
+  {
+    const int size_class = BufferPool::size_class( n * sizeof( T ) );
+    if ( size_class < 0 ) {
+      return static_cast<T*>( ::operator new( n * sizeof( T ) ) );
+    }
+    return static_cast<T*>( BufferPool::allocate( size_class ) );
+  }
+
+  void deallocate( T* ptr, size_t n ) noexcept
+  {
+    const int size_class = BufferPool::size_class( n * sizeof( T ) );
+    if ( size_class < 0 ) {
+      ::operator delete( ptr );
+      return;
+    }
+    BufferPool::deallocate( ptr, size_class );
+  }
+
+  friend bool operator==( const PoolAllocator& /* a */, const PoolAllocator& /* b */ ) { return true; }
+};
+
+//! A string whose storage comes from the BufferPool (when its capacity suits one of the pool's blocks)
+using PooledString = std::basic_string<char, std::char_traits<char>, PoolAllocator<char>>;
+
+//! Bytes whose storage comes from the BufferPool (when their number suits one of the pool's blocks)
+using PooledBytes = std::vector<char, PoolAllocator<char>>;
@@ -0,0 +1,24 @@
+#include "eventfd.hh"
+#include "exception.hh"
+
+#include <cstdint>
+#include <string>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+EventFD::EventFD() : FileDescriptor( ::CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) ) {}
+
+// notify() may be called from a thread other than the one polling the eventfd, so it doesn't
+// touch the FileDescriptor's (unsynchronized) write count
+void EventFD::notify()
+{
+  CheckSystemCall( "eventfd_write", eventfd_write( fd_num(), 1 ) );
+}
+
+void EventFD::clear()
+{
+  // reading the 8-byte counter resets it to zero (and counts as a read for EventLoop)
+  string counter( sizeof( eventfd_t ), '\0' );
+  read( counter );
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+//! A FileDescriptor to a non-blocking [eventfd](\ref man2::eventfd), used as a readiness flag between threads.
+//! It is readable (POLLIN) after notify() and until clear().
+class EventFD : public FileDescriptor
+{
+public:
+  EventFD();
+
+  //! Make the eventfd readable (wakes up a thread polling it)
+  void notify();
+
+  //! Reset the eventfd so that it is no longer readable
+  void clear();
+};
@@ -2,6 +2,9 @@
 
 #include "exception.hh"
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -149,6 +152,43 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 }
 
+size_t FileDescriptor::read( const vector<span<char>>& buffers )
+{
+  const size_t buffer_count = min( buffers.size(), static_cast<size_t>( IOV_MAX ) );
+
+  vector<iovec> iovecs;
+  iovecs.reserve( buffer_count );
+  size_t total_size = 0;
+  for ( size_t i = 0; i < buffer_count; ++i ) {
+    iovecs.push_back( { buffers[i].data(), buffers[i].size() } );
+    total_size += buffers[i].size();
+  }
+
+  if ( total_size == 0 ) {
+    return 0;
+  }
+
+  const ssize_t bytes_read = ::readv( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) );
+  if ( bytes_read < 0 ) {
+    if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      return 0;
+    }
+    throw unix_error { "read" };
+  }
+
+  register_read();
+
+  if ( bytes_read == 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
+  if ( bytes_read > static_cast<ssize_t>( total_size ) ) {
+    throw runtime_error( "read() read more than requested" );
+  }
+
+  return bytes_read;
+}
+
 size_t FileDescriptor::write( string_view buffer )
 {
   return write( vector<string_view> { buffer } );
@@ -166,12 +206,15 @@ size_t FileDescriptor::write( const vector<Ref<string>>& buffers )
 
 size_t FileDescriptor::write( const vector<string_view>& buffers )
 {
+  // writev() rejects more than IOV_MAX buffers, so write only the first IOV_MAX (a partial write)
+  const size_t buffer_count = min( buffers.size(), static_cast<size_t>( IOV_MAX ) );
+
   vector<iovec> iovecs;
-  iovecs.reserve( buffers.size() );
+  iovecs.reserve( buffer_count );
   size_t total_size = 0;
-  for ( const auto x : buffers ) {
-    iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
-    total_size += x.size();
+  for ( size_t i = 0; i < buffer_count; ++i ) {
+    iovecs.push_back( { const_cast<char*>( buffers[i].data() ), buffers[i].size() } ); // NOLINT(*-const-cast)
+    total_size += buffers[i].size();
   }
 
   const ssize_t bytes_written
@@ -189,6 +232,36 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
   return bytes_written;
 }
 
+size_t FileDescriptor::splice( FileDescriptor& destination, size_t len )
+{
+  if ( len == 0 ) {
+    return 0;
+  }
+
+  const ssize_t bytes_moved
+    = ::splice( fd_num(), nullptr, destination.fd_num(), nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+  if ( bytes_moved < 0 ) {
+    // with SPLICE_F_NONBLOCK, a full (or empty) pipe reports EAGAIN even if both fds are blocking
+    if ( errno == EAGAIN ) {
+      return 0;
+    }
+    throw unix_error { "splice" };
+  }
+
+  register_read();
+  destination.register_write();
+
+  if ( bytes_moved == 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
+  if ( bytes_moved > static_cast<ssize_t>( len ) ) {
+    throw runtime_error( "splice() moved more than requested" );
+  }
+
+  return bytes_moved;
+}
+
 void FileDescriptor::set_blocking( bool blocking )
 {
   int flags = CheckSystemCall( "fcntl", fcntl( fd_num(), F_GETFL ) ); // NOLINT(*-vararg)
@@ -3,6 +3,7 @@
 #include "ref.hh"
 #include <cstddef>
 #include <memory>
+#include <span>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -44,9 +45,6 @@ class FileDescriptor
   explicit FileDescriptor( std::shared_ptr<FDWrapper> other_shared_ptr );
 
 protected:
-  // size of buffer to allocate for read()
-  static constexpr size_t kReadBufferSize = 16384;
-
   void set_eof() { internal_fd_->eof_ = true; }
   void register_read() { ++internal_fd_->read_count_; }   // increment read count
   void register_write() { ++internal_fd_->write_count_; } // increment write count
@@ -55,6 +53,9 @@ protected:
   T CheckSystemCall( std::string_view s_attempt, T return_value ) const;
 
 public:
+  // size of buffer to allocate for read()
+  static constexpr size_t kReadBufferSize = 16384;
+
   // Construct from a file descriptor number returned by the kernel
   explicit FileDescriptor( int fd );
 
@@ -65,12 +66,21 @@ public:
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
 
+  // Read into caller-owned spans (e.g. from Writer::reserve), filling them in order
+  // returns number of bytes read
+  size_t read( const std::vector<std::span<char>>& buffers );
+
   // Attempt to write a buffer
   // returns number of bytes written
   size_t write( std::string_view buffer );
   size_t write( const std::vector<std::string_view>& buffers );
   size_t write( const std::vector<Ref<std::string>>& buffers );
 
+  // Move up to `len` bytes into `destination` inside the kernel, without copying them through user space
+  // ([splice(2)](\ref man2::splice); one of the two must be a pipe). The pipe side never blocks.
+  // returns number of bytes moved (0 if either side would block, or at EOF)
+  size_t splice( FileDescriptor& destination, size_t len );
+
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
 
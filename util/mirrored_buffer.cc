@@ -0,0 +1,186 @@
+#include "mirrored_buffer.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+namespace {
+FileDescriptor open_backing( MirroredBuffer::Backing backing )
+{
+  if ( backing == MirroredBuffer::Backing::Memory ) {
+    return FileDescriptor {
+      CheckSystemCall( "memfd_create", memfd_create( "minnow-mirrored-buffer", MFD_CLOEXEC ) ) };
+  }
+
+  const char* tmpdir = getenv( "TMPDIR" );
+  const string dir = tmpdir && *tmpdir ? tmpdir : "/tmp";
+  const int fd = open( dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR );
+  if ( fd >= 0 ) {
+    return FileDescriptor { fd };
+  }
+
+  // the filesystem doesn't support O_TMPFILE: create a named file and unlink it right away
+  string path = dir + "/minnow-spill-XXXXXX";
+  FileDescriptor file { CheckSystemCall( "mkostemp", mkostemp( path.data(), O_CLOEXEC ) ) };
+  CheckSystemCall( "unlink", unlink( path.c_str() ) );
+  return file;
+}
+} // namespace
+#endif
+
+MirroredBuffer::MirroredBuffer( size_t min_size, Backing backing ) : backing_( backing )
+{
+  map( min_size );
+}
+
+void MirroredBuffer::map( size_t min_size )
+{
+#ifdef __linux__
+  page_size_ = CheckSystemCall( "sysconf", static_cast<int>( sysconf( _SC_PAGESIZE ) ) );
+  size_ = min_size == 0 ? page_size_ : ( min_size + page_size_ - 1 ) / page_size_ * page_size_;
+
+  file_ = make_unique<FileDescriptor>( open_backing( backing_ ) );
+  CheckSystemCall( "ftruncate", ftruncate( file_->fd_num(), static_cast<off_t>( size_ ) ) );
+
+  // reserve twice the address space, then map the same file pages over both halves
+  void* const base = mmap( nullptr, 2 * size_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  if ( base == MAP_FAILED ) {
+    throw unix_error { "mmap" };
+  }
+  data_ = static_cast<char*>( base );
+
+  for ( char* const half : { data_, data_ + size_ } ) {
+    if ( mmap( half, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file_->fd_num(), 0 ) == MAP_FAILED ) {
+      const int saved_errno = errno;
+      unmap();
+      throw unix_error { "mmap", saved_errno };
+    }
+  }
+#else
+  static_cast<void>( min_size );
+  throw unix_error { "MirroredBuffer", ENOSYS };
+#endif
+}
+
+void MirroredBuffer::unmap()
+{
+#ifdef __linux__
+  if ( data_ ) {
+    munmap( data_, 2 * size_ );
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  file_.reset();
+}
+
+MirroredBuffer::~MirroredBuffer()
+{
+  unmap();
+}
+
+MirroredBuffer::MirroredBuffer( const MirroredBuffer& other ) : backing_( other.backing_ )
+{
+  if ( other.data_ ) {
+    map( other.size_ );
+    memcpy( data_, other.data_, size_ );
+  }
+}
+
+MirroredBuffer& MirroredBuffer::operator=( const MirroredBuffer& other )
+{
+  if ( this != &other ) {
+    MirroredBuffer copy { other };
+    swap( copy );
+  }
+  return *this;
+}
+
+MirroredBuffer::MirroredBuffer( MirroredBuffer&& other ) noexcept
+{
+  swap( other );
+}
+
+MirroredBuffer& MirroredBuffer::operator=( MirroredBuffer&& other ) noexcept
+{
+  if ( this != &other ) {
+    MirroredBuffer moved { std::move( other ) };
+    swap( moved );
+  }
+  return *this;
+}
+
+void MirroredBuffer::swap( MirroredBuffer& other ) noexcept
+{
+  std::swap( data_, other.data_ );
+  std::swap( size_, other.size_ );
+  std::swap( page_size_, other.page_size_ );
+  std::swap( backing_, other.backing_ );
+  std::swap( file_, other.file_ );
+}
+
+template<typename Drop>
+void MirroredBuffer::for_each_page_run( size_t offset, size_t len, Drop&& drop )
+{
+  // only whole pages can be dropped, so round the range inwards
+  const size_t first = ( offset + page_size_ - 1 ) / page_size_ * page_size_;
+  const size_t last = ( offset + len ) / page_size_ * page_size_;
+  if ( !data_ || first >= last ) {
+    return;
+  }
+  // a range that wraps past the end of the buffer continues at the start of the file
+  if ( first < size_ ) {
+    drop( first, min( last, size_ ) - first );
+  }
+  if ( last > size_ ) {
+    drop( max( first, size_ ) - size_, last - max( first, size_ ) );
+  }
+}
+
+void MirroredBuffer::page_out( size_t offset, size_t len )
+{
+#ifdef __linux__
+  for_each_page_run( offset, len, [&]( size_t file_offset, size_t run ) {
+    // unmap the pages from both halves, then ask the kernel to write them back and evict them from the cache
+    madvise( data_ + file_offset, run, MADV_DONTNEED );
+    madvise( data_ + size_ + file_offset, run, MADV_DONTNEED );
+    posix_fadvise(
+      file_->fd_num(), static_cast<off_t>( file_offset ), static_cast<off_t>( run ), POSIX_FADV_DONTNEED );
+  } );
+#else
+  static_cast<void>( offset );
+  static_cast<void>( len );
+#endif
+}
+
+void MirroredBuffer::discard( size_t offset, size_t len )
+{
+#ifdef __linux__
+  for_each_page_run( offset, len, [&]( size_t file_offset, size_t run ) {
+    // punching a hole frees the pages (and any disk blocks) without writing them back
+    madvise( data_ + file_offset, run, MADV_DONTNEED );
+    madvise( data_ + size_ + file_offset, run, MADV_DONTNEED );
+    fallocate( file_->fd_num(),
+               FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+               static_cast<off_t>( file_offset ),
+               static_cast<off_t>( run ) );
+  } );
+#else
+  static_cast<void>( offset );
+  static_cast<void>( len );
+#endif
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//! A circular buffer whose pages are mapped twice, back to back, in virtual memory ("magic ring").
+//! Byte `i` of the buffer is also visible at `data() + size() + i`, so any run of up to size() bytes
+//! starting anywhere in the buffer is contiguous. Linux-only (uses [memfd_create](\ref man2::memfd_create)).
+class MirroredBuffer
+{
+public:
+  //! What the mapped pages are backed by
+  enum class Backing : uint8_t
+  {
+    Memory,   //!< An anonymous memfd (RAM, or swap)
+    TempFile, //!< An unlinked file in $TMPDIR (or /tmp), so pages can be written back to disk and dropped
+  };
+
+private:
+  char* data_ {};                           //!< Start of the first of the two mappings
+  size_t size_ {};                          //!< Size of one mapping (a multiple of the page size)
+  size_t page_size_ {};                     //!< Granularity of page_out() and discard()
+  Backing backing_ {};                      //!< What the pages are backed by
+  std::unique_ptr<FileDescriptor> file_ {}; //!< The memfd or temporary file that is mapped
+
+  void map( size_t min_size );
+  void unmap();
+  void swap( MirroredBuffer& other ) noexcept;
+
+  //! Call `drop( file_offset, len )` for each run of whole pages in [offset, offset + len) (which may wrap)
+  template<typename Drop>
+  void for_each_page_run( size_t offset, size_t len, Drop&& drop );
+
+public:
+  //! An empty buffer that maps nothing
+  MirroredBuffer() = default;
+
+  //! Map a buffer of at least `min_size` bytes (rounded up to a multiple of the page size).
+  //! Throws unix_error if the mapping can't be set up (including on platforms without memfd).
+  explicit MirroredBuffer( size_t min_size, Backing backing = Backing::Memory );
+  ~MirroredBuffer();
+
+  //! Copying makes a new mapping (with the same backing) with the same contents
+  MirroredBuffer( const MirroredBuffer& other );
+  MirroredBuffer& operator=( const MirroredBuffer& other );
+  MirroredBuffer( MirroredBuffer&& other ) noexcept;
+  MirroredBuffer& operator=( MirroredBuffer&& other ) noexcept;
+
+  //! Drop the whole pages in [offset, offset + len) (wrapping around) from this process's memory,
+  //! writing them back to the backing first; their contents are kept and are paged back in on access.
+  //! Best effort: a page may stay cached while the kernel is still writing it back.
+  void page_out( size_t offset, size_t len );
+
+  //! Drop the whole pages in [offset, offset + len) (wrapping around) from memory and from the backing;
+  //! their contents become zero.
+  void discard( size_t offset, size_t len );
+
+  char* data() { return data_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  Backing backing() const { return backing_; }
+};
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "address.hh"
+#include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "reassembler.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 
@@ -12,13 +16,65 @@ class TCPConfig
 public:
   static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
   static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
+  static constexpr uint16_t DEFAULT_PEER_MSS = 536; //!< The peer's MSS if its SYN doesn't say (RFC 9293 3.7.1)
+  static constexpr uint16_t MIN_MSS = 88;           //!< Smallest MSS used, whatever a SYN says (as in Linux)
   static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
+  bool adaptive_rto = true;                //!< Derive the retransmission timeout from measured RTTs (RFC 6298)
+  uint16_t rt_timeout_min = 50;            //!< Floor of the adaptive retransmission timeout, in milliseconds
+  uint32_t rt_timeout_max = 60000;         //!< Ceiling of the adaptive retransmission timeout (and its back-off)
+
+  //! Retransmit on the third duplicate ack, and the next hole on each partial ack during recovery
+  //! (RFC 5681 fast retransmit, RFC 6582 NewReno recovery)
+  bool fast_retransmit = true;
+
+  //! Offer SACK on the SYN (RFC 2018), and resend only the holes the peer's SACK blocks leave (RFC 6675)
+  bool sack = true;
+
+  //! Offer window scaling on the SYN (RFC 7323), so windows can exceed 64 KiB
+  bool window_scaling = true;
+
+  //! Offer timestamps on the SYN (RFC 7323): an RTT sample from every ack, and PAWS against old duplicates
+  bool timestamps = true;
+
+  //! Maximum segment size: the largest payload our SYN says we accept, and (within the peer's MSS, less the
+  //! options that every segment carries) the largest we send
+  uint16_t mss = MAX_PAYLOAD_SIZE;
+
+  //! The MSS that fills a link's `mtu`-byte packets: what's left after the IPv4 and TCP headers
+  static uint16_t mss_for_mtu( size_t mtu )
+  {
+    constexpr size_t headers = 40; // IPv4 and TCP, without options
+    return static_cast<uint16_t>( std::clamp( mtu, headers + DEFAULT_PEER_MSS, headers + UINT16_MAX ) - headers );
+  }
+
+  //! Congestion control for the sender (see CongestionControl::Algorithm)
+  CongestionControl::Algorithm congestion_control = CongestionControl::Algorithm::NewReno;
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+
+  //! Sender storage: chunked, so bytes moved in from the application are not copied before segmentation
+  ByteStream::Storage send_storage = ByteStream::Storage::Chunked;
+
+  //! Most out-of-order bytes, and most bytes of memory for them, the receiver holds at once (beyond this, apply
+  //! recv_drop_policy)
+  uint64_t recv_reassembly_limit = UINT64_MAX;
+  Reassembler::DropPolicy recv_drop_policy = Reassembler::DropPolicy::Newest; //!< See Reassembler::DropPolicy
+
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14; //!< Largest window-scale shift count (RFC 7323)
+
+  //! The window-scale shift count for the receiver: the smallest that fits recv_capacity in a 16-bit window
+  uint8_t window_scale() const
+  {
+    uint8_t shift = 0;
+    while ( shift < MAX_WINDOW_SCALE and ( recv_capacity >> shift ) > UINT16_MAX ) {
+      shift++;
+    }
+    return shift;
+  }
 };
 
 //! Config for classes derived from FdAdapter
@@ -3,6 +3,7 @@
 #include "eventloop.hh"
 #include "file_descriptor.hh"
 #include "socket.hh"
+#include "spsc_byte_stream.hh"
 #include "tcp_config.hh"
 #include "tcp_peer.hh"
 #include "tuntap_adapter.hh"
@@ -56,6 +57,19 @@ public:
   // Return peer address from underlying datagram adapter
   const Address& peer_address() const { return _datagram_adapter.config().destination; }
 
+  //! Exchange bytes with the TCPPeer thread through in-memory SPSCByteStreams of the given capacity,
+  //! instead of through the socket. Must be called before connect() or listen_and_accept().
+  void use_direct_streams( uint64_t capacity );
+
+  //! \name
+  //! With direct streams, the owner thread writes to direct_outbound().writer() (closing it to finish the
+  //! outbound stream) and reads from direct_inbound().reader(), polling their eventfds instead of the socket.
+
+  //!@{
+  SPSCByteStream& direct_outbound();
+  SPSCByteStream& direct_inbound();
+  //!@}
+
 protected:
   //! Adapter to underlying datagram socket (e.g., UDP or IP)
   AdaptT _datagram_adapter;
@@ -64,6 +78,13 @@ private:
   //! Stream socket for reads and writes between owner and TCP thread
   LocalStreamSocket _thread_data;
 
+  //! Optional in-memory replacements for _thread_data (owner -> TCP thread, and TCP thread -> owner)
+  std::optional<SPSCByteStream> _direct_outbound {};
+  std::optional<SPSCByteStream> _direct_inbound {};
+
+  //! Add the event loop rules that move bytes between the TCPPeer and the direct streams
+  void _initialize_direct_streams();
+
   //! Set up the TCPPeer and the event loop
   void _initialize_TCP( const TCPConfig& config );
 
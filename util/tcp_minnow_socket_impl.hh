@@ -86,7 +86,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       }
 
       // debugging output:
-      if ( _thread_data.eof() and _tcp.value().sender().sequence_numbers_in_flight() == 0 and not _fully_acked ) {
+      if ( _outbound_shutdown and _tcp.value().sender().sequence_numbers_in_flight() == 0 and not _fully_acked ) {
         std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
                   << " has been fully acknowledged.\n";
         _fully_acked = true;
@@ -94,16 +94,20 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     },
     [&] { return _tcp->active(); } );
 
+  if ( _direct_outbound.has_value() ) {
+    _initialize_direct_streams();
+    return;
+  }
+
   // rule 2: read from pipe into outbound buffer
   _eventloop.add_rule(
     "push bytes to TCPPeer",
     _thread_data,
     Direction::In,
     [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      // Read straight into the outbound stream's storage
+      Writer& outbound = _tcp->outbound_writer();
+      outbound.commit( _thread_data.read( outbound.reserve( outbound.available_capacity() ) ) );
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -138,12 +142,11 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     Direction::Out,
     [&] {
       Reader& inbound = _tcp->inbound_reader();
-      // Write from the inbound_stream into
-      // the pipe, handling the possibility of a partial
+      // Write everything buffered in the inbound_stream into
+      // the pipe with a single writev, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
       if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
+        const auto bytes_written = _thread_data.write( inbound.peek_all() );
         inbound.pop( bytes_written );
       }
 
@@ -168,6 +171,90 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     } );
 }
 
+//! Rules 2 and 3 of _initialize_TCP, moving bytes to and from the owner through SPSCByteStreams.
+//! Their eventfds are edge-triggered, so each rule re-arms its own eventfd when it leaves work behind.
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_initialize_direct_streams()
+{
+  // rule 2: read from the owner's outbound stream into outbound buffer
+  _eventloop.add_rule(
+    "push bytes to TCPPeer",
+    _direct_outbound->readable_fd(),
+    Direction::In,
+    [&] {
+      _direct_outbound->readable_fd().clear();
+      SPSCReader& source = _direct_outbound->reader();
+      Writer& outbound = _tcp->outbound_writer();
+
+      while ( source.bytes_buffered() and outbound.available_capacity() ) {
+        const std::string_view region = source.peek();
+        uint64_t copied = 0;
+        for ( const auto span : outbound.reserve( region.size() ) ) {
+          region.copy( span.data(), span.size(), copied );
+          copied += span.size();
+        }
+        outbound.commit( copied );
+        source.pop( copied );
+      }
+
+      if ( source.bytes_buffered() ) {
+        _direct_outbound->readable_fd().notify(); // resume once the outbound buffer has room again
+      } else if ( source.is_finished() ) {
+        outbound.close();
+        _outbound_shutdown = true;
+        std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
+                  << " finished.\n";
+      }
+
+      if ( _direct_outbound->has_error() ) {
+        outbound.set_error();
+      }
+
+      _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+    },
+    [&] {
+      return ( _tcp->active() ) and ( not _outbound_shutdown )
+             and ( _tcp->outbound_writer().available_capacity() > 0 );
+    } );
+
+  // rule 3: read from inbound buffer into the owner's inbound stream
+  _eventloop.add_rule(
+    "read bytes from inbound stream",
+    _direct_inbound->writable_fd(),
+    Direction::In,
+    [&] {
+      _direct_inbound->writable_fd().clear();
+      Reader& inbound = _tcp->inbound_reader();
+      SPSCWriter& destination = _direct_inbound->writer();
+
+      while ( inbound.bytes_buffered() and destination.available_capacity() ) {
+        inbound.pop( destination.push( inbound.peek() ) );
+      }
+
+      if ( destination.available_capacity() ) {
+        _direct_inbound->writable_fd().notify(); // resume as soon as more inbound bytes arrive
+      }
+
+      if ( inbound.has_error() ) {
+        _direct_inbound->set_error();
+      }
+
+      if ( inbound.is_finished() or inbound.has_error() ) {
+        destination.close();
+        _inbound_shutdown = true;
+
+        // debugging output:
+        std::cerr << "DEBUG: minnow inbound stream from " << _datagram_adapter.config().destination.to_string()
+                  << " finished " << ( inbound.has_error() ? "uncleanly.\n" : "cleanly.\n" );
+      }
+    },
+    [&] {
+      return _tcp->inbound_reader().bytes_buffered()
+             or ( ( _tcp->inbound_reader().is_finished() or _tcp->inbound_reader().has_error() )
+                  and not _inbound_shutdown );
+    } );
+}
+
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
 //! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
 //! \returns a std::pair of connected sockets
@@ -201,10 +288,41 @@ TCPMinnowSocket<AdaptT>::~TCPMinnowSocket()
   }
 }
 
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::use_direct_streams( uint64_t capacity )
+{
+  if ( _tcp ) {
+    throw std::runtime_error( "use_direct_streams() with TCPConnection already initialized" );
+  }
+  _direct_outbound.emplace( capacity );
+  _direct_inbound.emplace( capacity );
+}
+
+template<TCPDatagramAdapter AdaptT>
+SPSCByteStream& TCPMinnowSocket<AdaptT>::direct_outbound()
+{
+  if ( not _direct_outbound.has_value() ) {
+    throw std::runtime_error( "direct_outbound() without use_direct_streams()" );
+  }
+  return _direct_outbound.value();
+}
+
+template<TCPDatagramAdapter AdaptT>
+SPSCByteStream& TCPMinnowSocket<AdaptT>::direct_inbound()
+{
+  if ( not _direct_inbound.has_value() ) {
+    throw std::runtime_error( "direct_inbound() without use_direct_streams()" );
+  }
+  return _direct_inbound.value();
+}
+
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::wait_until_closed()
 {
   shutdown( SHUT_RDWR );
+  if ( _direct_outbound.has_value() ) {
+    _direct_outbound->writer().close();
+  }
   if ( _tcp_thread.joinable() ) {
     std::cerr << "DEBUG: minnow waiting for clean shutdown... ";
     _tcp_thread.join();
@@ -277,6 +395,10 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
     }
     _tcp_loop( [] { return true; } );
     shutdown( SHUT_RDWR );
+    if ( _direct_inbound.has_value() and not _direct_inbound->writer().is_closed() ) {
+      _direct_inbound->set_error(); // wake up an owner still waiting for inbound bytes
+      _direct_inbound->writer().close();
+    }
     if ( not _tcp.value().active() ) {
       std::cerr << "DEBUG: minnow TCP connection finished "
                 << ( _tcp->inbound_reader().has_error() ? "uncleanly.\n" : "cleanly.\n" );
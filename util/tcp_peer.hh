@@ -7,6 +7,7 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
 #include <functional>
 #include <optional>
 
@@ -64,11 +65,27 @@ public:
     const auto our_ackno = receiver_.send().ackno;
     need_send_ |= ( our_ackno.has_value() and msg.sender->seqno + 1 == our_ackno.value() );
 
-    // Give incoming TCPSenderMessage to receiver.
-    receiver_.receive( std::move( msg.sender ) );
+    // A segment without data of its own is a pure ack (only those count as duplicate acks).
+    const bool pure_ack = msg.sender->sequence_length() == 0;
+
+    // The window-scale option of the peer's SYN takes effect after the SYN's own window (RFC 7323).
+    const bool syn = msg.sender->SYN;
+    const std::optional<uint8_t> peer_window_scale = msg.sender->window_scale;
+    const bool peer_sack_permitted = msg.sender->SACK_permitted;
+    const bool peer_timestamps = msg.sender->timestamp.has_value();
+    const std::optional<uint16_t> peer_mss = msg.sender->max_segment_size;
+
+    // Give incoming TCPSenderMessage to receiver (moving the payload when the message is owned).
+    receiver_.receive( msg.sender.release() );
 
     // Give incoming TCPReceiverMessage to sender.
-    sender_.receive( msg.receiver );
+    sender_.receive( msg.receiver, pure_ack );
+    if ( syn ) {
+      sender_.set_peer_window_scale( peer_window_scale );
+      sender_.set_peer_sack_permitted( peer_sack_permitted );
+      sender_.set_peer_timestamps( peer_timestamps );
+      sender_.set_peer_mss( peer_mss );
+    }
 
     // Send reply if needed.
     push( transmit );
@@ -88,14 +105,24 @@ public:
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
-  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
+  TCPSender sender_ { ByteStream { cfg_.send_capacity, cfg_.send_storage }, cfg_ };
+  TCPReceiver receiver_ {
+    Reassembler { ByteStream { cfg_.recv_capacity }, cfg_.recv_reassembly_limit, cfg_.recv_drop_policy },
+    cfg_.window_scaling ? std::optional { cfg_.window_scale() } : std::nullopt,
+    cfg_.timestamps };
 
   bool need_send_ {};
 
   void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
   {
-    transmit( { borrow( sender_message ), receiver_.send() } );
+    TCPReceiverMessage receiver_message = receiver_.send( sender_message.SYN );
+    // SACK blocks ride on data segments too: keep only as many as fit in the MSS beside the payload
+    const size_t max_payload = sender_.max_payload_size();
+    const size_t room = max_payload - std::min( sender_message.payload.size(), max_payload );
+    const size_t blocks_that_fit = room >= 4 ? ( room - 4 ) / 8 : 0;
+    receiver_message.sack_block_count
+      = static_cast<uint8_t>( std::min( size_t { receiver_message.sack_block_count }, blocks_that_fit ) );
+    transmit( { borrow( sender_message ), std::move( receiver_message ) } );
     need_send_ = false;
   }
 
@@ -2,26 +2,52 @@
 
 #include "wrapping_integers.hh"
 
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <span>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
  *
- * It contains three fields:
+ * It contains five fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by the TCP Receiver.
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
  *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    the <cstdint> header). With window scaling (RFC 7323), this is the window shifted right by the
+ *    receiver's window-scale shift count.
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 4) The SACK blocks (RFC 2018): up to four ranges of sequence numbers past the ackno that the receiver
+ *    already holds, most recently updated first, so the sender need not resend them.
+ *
+ * 5) The timestamp echo (TSecr, RFC 7323): the timestamp of the latest segment that arrived in order, so the
+ *    sender can time a round trip with every ack, even one that answers a retransmission.
  */
 
+// A range [begin, end) of sequence numbers
+struct SackBlock
+{
+  Wrap32 begin { 0 };
+  Wrap32 end { 0 };
+
+  bool operator==( const SackBlock& other ) const = default;
+};
+
 struct TCPReceiverMessage
 {
+  static constexpr size_t MAX_SACK_BLOCKS = 4; // As many as fit in a TCP header's options
+
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
   bool RST {};
+  std::array<SackBlock, MAX_SACK_BLOCKS> sack_blocks {};
+  uint8_t sack_block_count {};
+  std::optional<uint32_t> timestamp_echo {};
+
+  std::span<const SackBlock> sacks() const { return { sack_blocks.data(), sack_block_count }; }
 };
@@ -3,7 +3,9 @@
 #include "helpers.hh"
 #include "wrapping_integers.hh"
 
+#include <cstddef>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -48,29 +50,179 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
   if ( data_offset < ( HEADER_LENGTH >> 2 ) ) {
     parser.set_error();
     return;
   }
-  parser.remove_prefix( data_offset * 4 - HEADER_LENGTH );
+  parse_options( parser, static_cast<uint8_t>( data_offset * 4 - HEADER_LENGTH ) );
 
   parser.concatenate_all_remaining( message.sender->payload );
 }
 
+// Read the options we know and skip the rest (each is kind, length, value, except END and NOP)
+void TCPSegment::parse_options( Parser& parser, uint8_t length_left )
+{
+  uint8_t kind {};
+  uint8_t length {};
+  while ( length_left > 0 and not parser.has_error() ) {
+    parser.integer( kind );
+    length_left--;
+    if ( kind == OPTION_END ) {
+      break;
+    }
+    if ( kind == OPTION_NOP ) {
+      continue;
+    }
+
+    parser.integer( length );
+    if ( length < 2 or length - 1 > length_left ) {
+      parser.set_error();
+      return;
+    }
+    length_left -= length - 1;
+    const uint8_t value_length = length - 2;
+
+    if ( kind == OPTION_MSS and value_length == 2 ) {
+      uint16_t mss {};
+      parser.integer( mss );
+      message.sender->max_segment_size = mss;
+    } else if ( kind == OPTION_WINDOW_SCALE and value_length == 1 ) {
+      uint8_t shift {};
+      parser.integer( shift );
+      message.sender->window_scale = shift;
+    } else if ( kind == OPTION_SACK_PERMITTED and value_length == 0 ) {
+      message.sender->SACK_permitted = true;
+    } else if ( kind == OPTION_SACK and value_length % 8 == 0 ) {
+      uint32_t begin {};
+      uint32_t end {};
+      uint8_t count = 0;
+      for ( uint8_t i = 0; i < value_length / 8; i++ ) {
+        parser.integer( begin );
+        parser.integer( end );
+        if ( count < TCPReceiverMessage::MAX_SACK_BLOCKS ) {
+          message.receiver->sack_blocks.at( count++ ) = { Wrap32 { begin }, Wrap32 { end } };
+        }
+      }
+      message.receiver->sack_block_count = count;
+    } else if ( kind == OPTION_TIMESTAMPS and value_length == 8 ) {
+      uint32_t value {};
+      uint32_t echo {};
+      parser.integer( value );
+      parser.integer( echo );
+      message.sender->timestamp = value;
+      if ( message.receiver->ackno.has_value() ) {
+        message.receiver->timestamp_echo = echo; // only meaningful with ACK
+      }
+    } else {
+      parser.remove_prefix( value_length );
+    }
+  }
+  // whatever follows END is padding
+  parser.remove_prefix( length_left );
+}
+
 class Wrap32Serializable : public Wrap32
 {
 public:
   uint32_t raw_value() const { return raw_value_; }
 };
 
+bool TCPSegment::has_mss_option() const
+{
+  return message.sender->SYN and message.sender->max_segment_size.has_value();
+}
+
+bool TCPSegment::has_window_scale_option() const
+{
+  return message.sender->SYN and message.sender->window_scale.has_value();
+}
+
+bool TCPSegment::has_sack_permitted_option() const
+{
+  return message.sender->SYN and message.sender->SACK_permitted;
+}
+
+bool TCPSegment::has_sack_option() const
+{
+  return message.receiver->ackno.has_value() and sack_blocks_sent() > 0;
+}
+
+bool TCPSegment::has_timestamps_option() const
+{
+  return message.sender->timestamp.has_value();
+}
+
+// As many of the SACK blocks as fit in the option space the other options leave (three, with timestamps)
+uint8_t TCPSegment::sack_blocks_sent() const
+{
+  const size_t others = ( has_mss_option() ? 4 : 0 ) + ( has_window_scale_option() ? 4 : 0 )
+                        + ( has_sack_permitted_option() ? 4 : 0 ) + ( has_timestamps_option() ? 12 : 0 );
+  const size_t room = MAX_OPTIONS_LENGTH > others + 4 ? ( MAX_OPTIONS_LENGTH - others - 4 ) / 8 : 0;
+  return static_cast<uint8_t>( min( room, size_t { message.receiver->sack_block_count } ) );
+}
+
+size_t TCPSegment::options_length() const
+{
+  const size_t mss = has_mss_option() ? 4 : 0;
+  const size_t window_scale = has_window_scale_option() ? 4 : 0;
+  const size_t sack_permitted = has_sack_permitted_option() ? 4 : 0;
+  const size_t timestamps = has_timestamps_option() ? 12 : 0;
+  const size_t sack = has_sack_option() ? 4 + 8 * sack_blocks_sent() : 0;
+  return mss + window_scale + sack_permitted + timestamps + sack;
+}
+
+// The options, each aligned to 4 bytes with leading NOPs as is customary
+void TCPSegment::serialize_options( Serializer& serializer ) const
+{
+  if ( has_mss_option() ) {
+    serializer.integer( OPTION_MSS );
+    serializer.integer( uint8_t { 4 } );
+    serializer.integer( message.sender->max_segment_size.value() );
+  }
+  if ( has_window_scale_option() ) {
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_WINDOW_SCALE );
+    serializer.integer( uint8_t { 3 } );
+    serializer.integer( message.sender->window_scale.value() );
+  }
+  if ( has_sack_permitted_option() ) {
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_SACK_PERMITTED );
+    serializer.integer( uint8_t { 2 } );
+  }
+  if ( has_timestamps_option() ) {
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_TIMESTAMPS );
+    serializer.integer( uint8_t { 10 } );
+    serializer.integer( message.sender->timestamp.value() );
+    serializer.integer( message.receiver->ackno.has_value() ? message.receiver->timestamp_echo.value_or( 0 ) : 0 );
+  }
+  if ( has_sack_option() ) {
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_SACK );
+    serializer.integer( static_cast<uint8_t>( 2 + 8 * sack_blocks_sent() ) );
+    for ( const SackBlock& block : message.receiver->sacks().first( sack_blocks_sent() ) ) {
+      serializer.integer( Wrap32Serializable { block.begin }.raw_value() );
+      serializer.integer( Wrap32Serializable { block.end }.raw_value() );
+    }
+  }
+}
+
 void TCPSegment::serialize( Serializer& serializer ) const
 {
+  const size_t options_len = options_length();
+  if ( options_len > MAX_OPTIONS_LENGTH ) {
+    throw runtime_error( "TCP options don't fit in the header" );
+  }
+
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender->seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver->ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { ( HEADER_LENGTH >> 2 ) << 4 } ); // data offset
+  serializer.integer( static_cast<uint8_t>( ( ( HEADER_LENGTH + options_len ) >> 2 ) << 4 ) ); // data offset
   const bool reset = message.sender->RST or message.receiver->RST;
   const uint8_t flags = ( message.receiver->ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender->SYN ? 0b0000'0010U : 0 ) | ( message.sender->FIN ? 0b0000'0001U : 0 );
@@ -78,6 +230,7 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( message.receiver->window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+  serialize_options( serializer );
   serializer.buffer( message.sender->payload );
 }
 
@@ -99,6 +252,18 @@ string TCPSegment::to_string() const
   ss << " seqno=" << Wrap32Serializable { message.sender->seqno }.raw_value();
   if ( message.sender->SYN ) {
     ss << " +SYN";
+    if ( message.sender->max_segment_size.has_value() ) {
+      ss << " MSS=" << message.sender->max_segment_size.value();
+    }
+    if ( message.sender->window_scale.has_value() ) {
+      ss << " WS=" << static_cast<unsigned>( message.sender->window_scale.value() );
+    }
+    if ( message.sender->SACK_permitted ) {
+      ss << " +SACK_PERM";
+    }
+  }
+  if ( message.sender->timestamp.has_value() ) {
+    ss << " TSval=" << message.sender->timestamp.value();
   }
   if ( not message.sender->payload.empty() ) {
     ss << " payload=\"" << pretty_print( message.sender->payload ) << "\"";
@@ -112,6 +277,13 @@ string TCPSegment::to_string() const
   auto ackno = message.receiver->ackno;
   if ( ackno.has_value() ) {
     ss << " ACK<" << Wrap32Serializable { *ackno }.raw_value() << ">";
+    for ( const SackBlock& block : message.receiver->sacks().first( sack_blocks_sent() ) ) {
+      ss << " SACK<" << Wrap32Serializable { block.begin }.raw_value() << "-"
+         << Wrap32Serializable { block.end }.raw_value() << ">";
+    }
+    if ( message.receiver->timestamp_echo.has_value() ) {
+      ss << " TSecr=" << message.receiver->timestamp_echo.value();
+    }
   }
   ss << " winsize=" << message.receiver->window_size;
   ss << " src=" << udinfo.src_port << " dst=" << udinfo.dst_port;
@@ -27,8 +27,32 @@ struct TCPSegment
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
 
-  static constexpr uint8_t HEADER_LENGTH = 20; // TCP header length, not including options
+  static constexpr uint8_t HEADER_LENGTH = 20;     // TCP header length, not including options
+  static constexpr uint8_t MAX_OPTIONS_LENGTH = 40; // the 4-bit data offset allows at most 60 bytes of header
+
+  // TCP option kinds (RFC 9293, RFC 7323 and RFC 2018)
+  static constexpr uint8_t OPTION_END = 0;
+  static constexpr uint8_t OPTION_NOP = 1;
+  static constexpr uint8_t OPTION_MSS = 2;
+  static constexpr uint8_t OPTION_WINDOW_SCALE = 3;
+  static constexpr uint8_t OPTION_SACK_PERMITTED = 4;
+  static constexpr uint8_t OPTION_SACK = 5;
+  static constexpr uint8_t OPTION_TIMESTAMPS = 8;
+
+  // The length of the header as serialized, with its options
+  size_t header_length() const { return HEADER_LENGTH + options_length(); }
 
   // Return a string containing a summary in human-readable format
   std::string to_string() const;
+
+private:
+  bool has_mss_option() const;
+  bool has_window_scale_option() const;
+  bool has_sack_permitted_option() const;
+  bool has_sack_option() const;
+  bool has_timestamps_option() const;
+  uint8_t sack_blocks_sent() const;
+  size_t options_length() const;
+  void parse_options( Parser& parser, uint8_t length_left );
+  void serialize_options( Serializer& serializer ) const;
 };
@@ -2,12 +2,14 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 /*
  * The TCPSenderMessage structure contains the information sent from a TCP sender to its receiver.
  *
- * It contains five fields:
+ * It contains nine fields:
  *
  * 1) The sequence number (seqno) of the beginning of the segment. If the SYN flag is set, this is the
  *    sequence number of the SYN flag. Otherwise, it's the sequence number of the beginning of the payload.
@@ -20,6 +22,18 @@
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 6) The SACK-permitted option (RFC 2018), only meaningful with SYN: the sender understands SACK blocks,
+ *    so the peer's receiver may send them.
+ *
+ * 7) The window-scale option (RFC 7323), only meaningful with SYN: the shift count that the sender's own
+ *    receiver applies to the windows it advertises. Scaling is in effect only if both SYNs carry it.
+ *
+ * 8) The timestamp (TSval, RFC 7323): the sender's clock, in milliseconds, when the segment was sent. Once
+ *    both SYNs carry one, every segment does, and the peer's receiver echoes it back.
+ *
+ * 9) The maximum segment size option (MSS, RFC 9293), only meaningful with SYN: the largest payload that the
+ *    sender's own receiver accepts in one segment.
  */
 
 struct TCPSenderMessage
@@ -32,6 +46,11 @@ struct TCPSenderMessage
 
   bool RST {};
 
+  bool SACK_permitted {};
+  std::optional<uint8_t> window_scale {};
+  std::optional<uint32_t> timestamp {};
+  std::optional<uint16_t> max_segment_size {};
+
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }
 };
@@ -1,5 +1,6 @@
 #include "tun.hh"
 #include "exception.hh"
+#include "socket.hh"
 
 #include <cstring>
 #include <fcntl.h>
@@ -36,3 +37,15 @@ TunTapFD::TunTapFD( const string& devname, const bool is_tun )
 
   CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETIFF, static_cast<void*>( &tun_req ) ) );
 }
+
+size_t TunTapFD::mtu() const
+{
+  struct ifreq if_req
+  {};
+
+  // the device's name, then its MTU (which only a socket can ask for)
+  CheckSystemCall( "ioctl", ioctl( fd_num(), TUNGETIFF, static_cast<void*>( &if_req ) ) );
+  const UDPSocket socket;
+  CheckSystemCall( "ioctl", ioctl( socket.fd_num(), SIOCGIFMTU, static_cast<void*>( &if_req ) ) );
+  return static_cast<size_t>( if_req.ifr_mtu );
+}
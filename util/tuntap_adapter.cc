@@ -1,6 +1,9 @@
 #include "tuntap_adapter.hh"
 #include "helpers.hh"
 
+#include <string>
+#include <vector>
+
 using namespace std;
 
 optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
@@ -22,6 +22,10 @@ private:
   TunFD _tun;
 
 public:
+  //! The largest datagram read() takes in whole: the two headers, plus one read buffer for the rest
+  static constexpr size_t MAX_DATAGRAM_SIZE
+    = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + FileDescriptor::kReadBufferSize;
+
   //! Construct from a TunFD
   explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) ) {}
 